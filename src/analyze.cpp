@@ -0,0 +1,233 @@
+#include "analyze.h"
+#include "boardstate.h"
+#include "evaluate.h"
+#include "move.h"
+#include "move_gen.h"
+#include "search.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_DEPTH 8
+#define DEFAULT_HASH 16
+// positions read ahead of the oldest unwritten result, per thread
+#define WINDOW_PER_THREAD 64
+
+struct analysis_job {
+    std::istream* input;
+    std::ostream* output;
+    search_limits limits;
+    size_t hash;
+
+    std::mutex lock;
+    std::condition_variable written;
+    uint64_t next_read = 0;         // index of the next line
+    uint64_t next_write = 0;        // index of the next line to output
+    uint64_t window;
+    std::map<uint64_t, std::string> done;     // finished, waiting for earlier lines
+};
+
+static std::string json_string(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if ((unsigned char)c >= 0x20)
+            out += c;
+    }
+    return out + "\"";
+}
+
+// the board fields of an epd line (4 fields and the optional 3-check
+// counters) and its id operation if there is one
+static bool parse_epd(const std::string& line, std::string& fen, std::string& id) {
+    std::istringstream fields(line);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (tokens.size() < 5 && fields >> token)
+        tokens.push_back(token);
+    if (tokens.size() < 4)
+        return false;
+
+    fen = tokens[0] + " " + tokens[1] + " " + tokens[2] + " " + tokens[3];
+    if (tokens.size() == 5 && tokens[4].find('+') != std::string::npos)
+        fen += " " + tokens[4];
+
+    size_t pos = line.find(" id ");
+    if (pos != std::string::npos) {
+        size_t start = line.find('"', pos);
+        size_t end = start == std::string::npos ? start : line.find('"', start + 1);
+        if (end != std::string::npos)
+            id = line.substr(start + 1, end - start - 1);
+    }
+    return true;
+}
+
+static std::string analyze_line(SearchContext& engine, const analysis_job& job,
+                                uint64_t index, const std::string& line) {
+    std::string fen, id;
+    std::string json = "{\"index\": " + std::to_string(index);
+
+    Boardstate B;
+    if (!parse_epd(line, fen, id) || !B.set_fen(fen))
+        return json + ", \"line\": " + json_string(line) + ", \"error\": \"invalid position\"}";
+    if (!id.empty())
+        json += ", \"id\": " + json_string(id);
+    json += ", \"fen\": " + json_string(fen);
+
+    // every position gets a fresh context, results don't depend on
+    // which worker searched what before
+    engine.tt.clear();
+    engine.clear_game_history();
+    engine.clear_move_stats();
+
+    if (!has_legal_move(B))
+        return json + ", \"bestmove\": null, \"result\": " +
+               (is_attacked(B, lsb(B.pieces[B.to_move][KING])) ? "\"checkmate\"}" : "\"stalemate\"}");
+
+    search_info last = {};
+    Move m = engine.think(B, job.limits, [&last](const search_info& info) {
+        if (info.multipv == 1)
+            last = info;
+    });
+
+    // a node or time limit hit before depth 1 was done, the move is
+    // just the first legal one and there is no score to report
+    if (last.depth == 0)
+        return json + ", \"bestmove\": \"" + move_to_str(m) + "\", \"result\": \"interrupted\""
+               ", \"nodes\": " + std::to_string(engine.get_stats().nodes) + "}";
+
+    int score = B.to_move == WHITE ? engine.get_score() : -engine.get_score();
+    json += ", \"bestmove\": \"" + move_to_str(m) + "\"";
+    if (score > MATE_BOUND)
+        json += ", \"mate\": " + std::to_string((MATE_SCORE - score + 1) / 2);
+    else if (score < -MATE_BOUND)
+        json += ", \"mate\": " + std::to_string(-(MATE_SCORE + score + 1) / 2);
+    else
+        json += ", \"score\": " + std::to_string(score);
+
+    json += ", \"depth\": " + std::to_string(last.depth)
+          + ", \"nodes\": " + std::to_string(engine.get_stats().nodes)
+          + ", \"time\": " + std::to_string(last.time)
+          + ", \"pv\": [";
+    for (size_t i = 0; i < last.pv.size(); i++)
+        json += (i ? ", \"" : "\"") + move_to_str(last.pv[i]) + "\"";
+    return json + "]}";
+}
+
+static void worker(analysis_job& job) {
+    auto engine = std::make_unique<SearchContext>();
+    engine->tt.resize(job.hash);
+
+    while (true) {
+        uint64_t index;
+        std::string line;
+        {
+            // stay within the window, the writer needs the oldest line first
+            std::unique_lock<std::mutex> lock(job.lock);
+            job.written.wait(lock, [&job]() { return job.next_read - job.next_write < job.window; });
+
+            do {
+                if (!std::getline(*job.input, line))
+                    return;
+            } while (line.find_first_not_of(" \t\r") == std::string::npos);
+            index = job.next_read++;
+        }
+
+        std::string result = analyze_line(*engine, job, index, line);
+
+        std::lock_guard<std::mutex> lock(job.lock);
+        job.done[index] = result;
+        uint64_t written = job.next_write;
+        while (!job.done.empty() && job.done.begin()->first == job.next_write) {
+            *job.output << job.done.begin()->second << "\n";
+            job.done.erase(job.done.begin());
+            job.next_write++;
+        }
+
+        // a result waiting for an earlier line wrote nothing
+        if (job.next_write != written) {
+            job.output->flush();
+            job.written.notify_all();
+        }
+    }
+}
+
+int analyze_epd(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " analyze-epd FILE [--depth N] [--nodes N] [--movetime MS]"
+                  << " [--threads N] [--hash MB] [--output FILE]\n";
+        return 1;
+    }
+
+    std::string input_file = argv[2], output_file;
+    int threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+    analysis_job job;
+    job.hash = DEFAULT_HASH;
+    job.limits.depth = 0;
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        const char* value = argv[i + 1];
+        if (arg == "--depth")
+            job.limits.depth = std::clamp(std::atoi(value), 1, MAX_PLY - 1);
+        else if (arg == "--nodes")
+            job.limits.nodes = std::strtoull(value, nullptr, 10);
+        else if (arg == "--movetime")
+            job.limits.hard_time = std::atoi(value);
+        else if (arg == "--threads")
+            threads = std::max(std::atoi(value), 1);
+        else if (arg == "--hash")
+            job.hash = std::max(std::atoi(value), 1);
+        else if (arg == "--output")
+            output_file = value;
+    }
+    // without any limit the search stops at DEFAULT_DEPTH
+    if (job.limits.depth == 0)
+        job.limits.depth = job.limits.nodes || job.limits.hard_time ? MAX_PLY - 1 : DEFAULT_DEPTH;
+
+    std::ifstream input(input_file);
+    if (!input) {
+        std::cerr << "Cannot open " << input_file << "\n";
+        return 1;
+    }
+    std::ofstream output;
+    if (!output_file.empty()) {
+        output.open(output_file);
+        if (!output) {
+            std::cerr << "Cannot write " << output_file << "\n";
+            return 1;
+        }
+    }
+
+    init_move_tables();
+    init_eval_tables();
+    init_zobrist_table(0x0);
+
+    job.input = &input;
+    job.output = output_file.empty() ? &std::cout : &output;
+    job.window = (uint64_t)threads * WINDOW_PER_THREAD;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++)
+        pool.emplace_back(worker, std::ref(job));
+    for (auto& t : pool)
+        t.join();
+
+    auto milis = std::chrono::duration_cast<std::chrono::milliseconds>
+                 (std::chrono::steady_clock::now() - start).count();
+    std::cerr << job.next_write << " positions, " << threads << " threads, " << milis << " ms\n";
+    return 0;
+}
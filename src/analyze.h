@@ -0,0 +1,11 @@
+#ifndef _ANALYZE_H_
+#define _ANALYZE_H_
+
+// engine analyze-epd FILE [--depth N] [--nodes N] [--movetime MS]
+//                         [--threads N] [--hash MB] [--output FILE]
+// searches every position of an epd file on a pool of threads, one
+// search context each, and writes one json line per position in input
+// order; returns the exit code
+int analyze_epd(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,100 @@
+#include "bench.h"
+#include "boardstate.h"
+#include "evaluate.h"
+#include "move_gen.h"
+#include "search.h"
+#include "transpositions.h"
+#include "zobrist.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+// openings, middlegames and endings with different checks left ("W+B"),
+// changing any of them changes the signature
+const char* const bench_positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 3+3 0 1",
+    "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 3+3 0 2",
+    "rnbqkb1r/pppp1ppp/5n2/4p3/2B1P3/8/PPPP1PPP/RNBQK1NR w KQkq - 3+3 2 3",
+    "r1bqkbnr/pppp1ppp/2n5/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R b KQkq - 3+3 3 3",
+    "rnbqkbnr/ppp1pppp/8/3p4/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 3+3 0 2",
+    "rnbqkb1r/pp2pppp/3p1n2/8/3NP3/8/PPP2PPP/RNBQKB1R w KQkq - 3+3 1 5",
+    "r1bqk2r/pppp1ppp/2n2n2/2b1p3/2B1P3/3P1N2/PPP2PPP/RNBQK2R w KQkq - 3+3 1 5",
+    "rnbqkb1r/pppp1ppp/5n2/4p3/4P3/5Q2/PPPP1PPP/RNB1KBNR w KQkq - 2+3 2 3",
+    "rnb1kbnr/pppp1ppp/8/4p3/4P2q/8/PPPP1PPP/RNBQKBNR w KQkq - 3+2 2 3",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 3+3 4 4",
+    "r1b1kb1r/pppp1ppp/2n2n2/4p1q1/2B1P3/2N5/PPPP1PPP/R1BQK1NR w KQkq - 2+2 4 5",
+    "r3k2r/pppq1ppp/2nbbn2/3pp3/3PP3/2NBBN2/PPPQ1PPP/R3K2R w KQkq - 3+3 0 8",
+    "r2qkb1r/pp1n1ppp/2p1pn2/3p1b2/2PP4/1QN1PN2/PP3PPP/R1B1KB1R w KQkq - 3+3 2 7",
+    "r1bq1rk1/ppp2ppp/2np1n2/2b1p3/2B1P3/2NP1N2/PPP2PPP/R1BQ1RK1 w - - 3+3 0 7",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 3+3 0 10",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 3+3 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 2+3 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1+3 1 8",
+    "2kr3r/ppp2ppp/2n1b3/2b1q3/4P3/2NB1Q2/PPP2PPP/R1B2RK1 w - - 2+2 4 12",
+    "r1b2rk1/pp2qppp/2n1pn2/3p4/2PP4/P1Q1PN2/1P3PPP/R1B1KB1R w KQ - 2+3 1 9",
+    "4rrk1/pp3ppp/3q1n2/2pp4/3P4/2PQ1N2/PP3PPP/4RRK1 w - - 1+1 0 18",
+    "r1b1k2r/ppq2ppp/2n1pn2/3p4/1b1P4/2NBPN2/PPQ2PPP/R1B1K2R w KQkq - 3+2 3 8",
+    "rn3rk1/pbppq1pp/1p2pb2/4N2Q/3PN3/3B4/PPP2PPP/R3K2R w KQ - 2+3 3 11",
+    "r2q1rk1/pb1nbppp/1p2pn2/2pp4/2PP4/1PN1PN2/PB1QBPPP/R4RK1 w - - 3+3 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 3+3 0 1",
+    "8/8/4k3/8/2p5/8/B2K4/8 w - - 1+1 0 40",
+    "8/5pk1/6p1/8/2Q5/6P1/5PK1/8 w - - 1+2 0 45",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 2+2 0 30",
+    "8/8/8/2k5/8/8/3QK3/8 w - - 1+3 0 60",
+    "8/5k2/8/8/8/8/2K5/R7 w - - 2+1 0 55",
+    "4k3/8/8/8/8/8/4P3/4K3 w - - 3+3 0 50",
+    "6k1/pp3ppp/8/3r4/8/2R5/PP3PPP/6K1 w - - 1+1 0 28",
+    "2r3k1/5ppp/8/1p6/8/1P3N2/5PPP/2R3K1 b - - 2+1 0 33",
+    "8/3k4/2p1p3/1pP1P3/1P6/3K4/8/8 w - - 3+3 0 48",
+    "r5k1/5ppp/8/8/8/8/1q3PPP/R2Q2K1 w - - 1+1 0 35",
+    "6k1/6p1/6Pp/7P/5K2/8/8/8 w - - 2+2 0 60",
+    "1k6/ppp5/8/8/8/8/5PPP/4QRK1 b - - 1+2 0 38",
+    "3q2k1/5ppp/8/8/8/8/5PPP/3QR1K1 w - - 1+1 0 42",
+    "r1bqk2r/ppp2ppp/2n5/3np3/1b6/2NP1N2/PP2PPPP/R1BQKB1R w KQkq - 2+2 0 7",
+    "rnbqk2r/ppp1bppp/4pn2/3p2B1/2PP4/2N5/PP2PPPP/R2QKBNR w KQkq - 3+3 4 5",
+};
+const int bench_position_count = sizeof(bench_positions) / sizeof(bench_positions[0]);
+
+uint64_t bench(int depth) {
+    // the engine's tables and seed, hashes decide the tt layout and so the node count
+    init_move_tables();
+    init_eval_tables();
+    init_zobrist_table(0x0);
+    SearchContext engine;
+    engine.tt.resize(16);
+
+    int count = bench_position_count;
+    uint64_t nodes = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < count; i++) {
+        Boardstate B;
+        if (!B.set_fen(bench_positions[i])) {
+            std::cout << "Invalid bench position " << bench_positions[i] << "\n";
+            continue;
+        }
+
+        // every position starts from the same search state
+        engine.tt.clear();
+        engine.clear_game_history();
+        engine.clear_move_stats();
+
+        search_limits limits;
+        limits.depth = depth;
+        Move m = engine.think(B, limits);
+
+        nodes += engine.get_stats().nodes;
+        std::cout << "Position " << i + 1 << "/" << count << " " << move_to_str(m)
+                  << " nodes " << engine.get_stats().nodes << "\n";
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    uint64_t milis = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count();
+
+    std::cout << "\n===========================\n"
+              << "Depth          : " << depth << "\n"
+              << "Total time (ms): " << milis << "\n"
+              << "Nodes searched : " << nodes << "\n"
+              << "Nodes/second   : " << (milis ? nodes * 1000 / milis : 0) << "\n" << std::flush;
+    return nodes;
+}
@@ -0,0 +1,16 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+#include <stdint.h>
+
+#define BENCH_DEPTH 6
+
+// searches a fixed set of 3-check positions to depth with a fresh 16 MB
+// table and prints the total node count (the signature of the search,
+// same for every build of the same code) and the speed; returns the nodes
+uint64_t bench(int depth = BENCH_DEPTH);
+
+// fens searched by bench, also the corpus of the microbenchmarks
+extern const char* const bench_positions[];
+extern const int bench_position_count;
+
+#endif
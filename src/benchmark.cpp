@@ -1,10 +1,13 @@
 #include <iostream>
 #include <string>
 #include <chrono>
+#include "bench.h"
 #include "boardstate.h"
 #include "evaluate.h"
 #include "move.h"
 #include "move_gen.h"
+#include "perf_counters.h"
+#include "pgn.h"
 #include "search.h"
 #include "transpositions.h"
 #include "zobrist.h"
@@ -44,10 +47,32 @@ int count_moves(Boardstate B, Move mov, int depth) {
     return count + 1;
 }
 
+// standard perft positions with reference node counts for depths 1..5
+// (https://www.chessprogramming.org/Perft_Results)
+struct perft_position {
+    string fen;
+    uint64_t nodes[5];
+};
+
+const perft_position perft_positions[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        {20, 400, 8902, 197281, 4865609}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        {48, 2039, 97862, 4085603, 193690690}},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        {14, 191, 2812, 43238, 674624}},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        {6, 264, 9467, 422333, 15833292}},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        {44, 1486, 62379, 2103487, 89941194}},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        {46, 2079, 89890, 3894594, 164075551}},
+};
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         cout << "Usage: " + string(argv[0]) + " [TEST]\n";
-        cout << "Tests: [movegen] [search [DEPTH]]\n";
+        cout << "Tests: [movegen] [perft [DEPTH]] [search [DEPTH] [--stats]] [bench [DEPTH]] [pgn FILE]\n";
         return 0; 
     }
 
@@ -63,50 +88,141 @@ int main(int argc, char* argv[]) {
         B.reset();
         cout << B.get_state() << '\n';
 
+        perf_counters counters;
+        counters.start();
         auto start = chrono::high_resolution_clock::now();
         move_list moves;
         generate_all_moves(B, moves);
 
+        uint64_t nodes = 0;
         for (auto m : moves.quiet) {
             int x = count_moves(B, m, 5);
+            nodes += x;
             cout << "\t" << square_map[get_src(m)] << square_map[get_dest(m)] << ": " << x << "\n";
         }
 
+        auto stop = chrono::high_resolution_clock::now();
+        counters.stop();
+        int milis = chrono::duration_cast<chrono::milliseconds>(stop - start).count();
+
+        cout << "\nNodes: " << nodes << "\n";
+        cout << "Time: " << (float)milis / 1000 << "s\n";
+        cout << "NPS: " << nodes * 1000 / max(milis, 1) << "\n";
+        cout << perf_report(counters, nodes, "node");
+    }
+    else if (string(argv[1]) == "perft") {
+        int depth = argc > 2 ? atoi(argv[2]) : 4;
+        depth = max(1, min(depth, 5));
+        cout << "Perft on reference positions, depth: " << depth << "\n\n";
+
+        bool ok = true;
+        uint64_t total = 0;
+        perf_counters counters;
+        counters.start();
+        auto start = chrono::high_resolution_clock::now();
+
+        for (auto& pos : perft_positions) {
+            Boardstate B;
+            B.set_fen(pos.fen);
+
+            uint64_t nodes = perft(B, depth);
+            total += nodes;
+
+            bool match = nodes == pos.nodes[depth - 1];
+            ok &= match;
+            cout << "\t" << (match ? "OK   " : "FAIL ") << nodes << " (expected "
+                 << pos.nodes[depth - 1] << ") " << pos.fen << "\n";
+        }
+
+        auto stop = chrono::high_resolution_clock::now();
+        counters.stop();
+        int milis = chrono::duration_cast<chrono::milliseconds>(stop - start).count();
+
+        cout << "\nNodes: " << total << "\n";
+        cout << "Time: " << (float)milis / 1000 << "s\n";
+        cout << "NPS: " << total * 1000 / max(milis, 1) << "\n";
+        cout << perf_report(counters, total, "node");
+        return ok ? 0 : 1;
+    }
+    else if (string(argv[1]) == "bench") {
+        bench(argc > 2 ? atoi(argv[2]) : BENCH_DEPTH);
+    }
+    else if (string(argv[1]) == "pgn") {
+        PgnReader reader(argc > 2 ? argv[2] : "");
+        if (!reader.is_open()) {
+            cout << "Could not read " << (argc > 2 ? argv[2] : "(no file)") << "\n";
+            return 1;
+        }
+
+        uint64_t games = 0, plies = 0, errors = 0;
+        pgn_game game;
+        auto start = chrono::high_resolution_clock::now();
+        while (reader.next(game)) {
+            games++;
+            plies += game.moves.size();
+            errors += game.error;
+        }
         auto stop = chrono::high_resolution_clock::now();
         int milis = chrono::duration_cast<chrono::milliseconds>(stop - start).count();
 
-        cout << "\nTime: " << (float)milis / 1000 << "ms\n";
+        cout << "Games: " << games << " (" << errors << " with errors)\n";
+        cout << "Plies: " << plies << "\n";
+        cout << "Time: " << (float)milis / 1000 << "s\n";
+        cout << "Games/s: " << games * 1000 / max(milis, 1) << ", plies/s: " << plies * 1000 / max(milis, 1) << "\n";
     }
     else if (string(argv[1]) == "search") {
         cout << "Testing searching with prunning and other goodies!\n";
         int depth = atoi(argv[2]);
-        set_search_depth(depth);
-        cout << "Searching depth: " << depth << "!\n\n"; 
+        bool print_stats = argc > 3 && string(argv[3]) == "--stats";
+        cout << "Searching depth: " << depth << "!\n";
+        cout << "Boardstate copy size: " << sizeof(Boardstate) << " bytes\n\n";
 
         Boardstate B;
         B.reset();
-        B.make_move(encode(d2, d4, PAWN, PAWN, NO_FLAGS));
-        B.make_move(encode(e7, e5, PAWN, PAWN, NO_FLAGS));
-        B.make_move(encode(b2, b7, PAWN, PAWN, CAPTURE));
-        B.make_move(encode(c7, c5, PAWN, PAWN, NO_FLAGS));
-        B.make_move(encode(g1, f3, KNIGHT, KNIGHT, NO_FLAGS));
-        B.make_move(encode(h7, h4, PAWN, PAWN, NO_FLAGS));
-        B.make_move(encode(g2, g4, PAWN, PAWN, ENPASSANT));
-        B.make_move(encode(f7, f6, PAWN, PAWN, NO_FLAGS));
+        B.make_move(encode(d2, d4));
+        B.make_move(encode(e7, e5));
+        B.make_move(encode(b2, b7));
+        B.make_move(encode(c7, c5));
+        B.make_move(encode(g1, f3));
+        B.make_move(encode(h7, h4));
+        B.make_move(encode(g2, g4));
+        B.make_move(encode(f7, f6));
         cout << B.get_state() << '\n';
 
         auto start = chrono::high_resolution_clock::now();
 
+        SearchContext engine;
+        search_stats total;
+        perf_counters counters;
+        counters.start();
         for (auto i = 0; i < 20; i++) {
-//            std::cout << "\t" << "TT size: " << get_trans_table_size() << '\n';
-            std::cout << "\t" << B.engine_move(1000000, depth);
+//            std::cout << "\t" << "TT size: " << engine.tt.size() << '\n';
+            std::cout << "\t" << B.engine_move(engine, 1000000, depth);
 //            std::cout << B.get_state() << '\n';
+            total += engine.get_stats();
         }
 
         auto stop = chrono::high_resolution_clock::now();
+        counters.stop();
         int milis = chrono::duration_cast<chrono::milliseconds>(stop - start).count();
 
         cout << "\nTime: " << (float)milis / 1000 << "s\n";
+        cout << perf_report(counters, total.nodes, "node");
+
+        if (print_stats) {
+            auto percent = [](uint64_t part, uint64_t total) {
+                return total ? 100.0 * part / total : 0.0;
+            };
+            cout << "Nodes: " << total.nodes << " (" << (milis ? total.nodes * 1000 / milis : 0) << " nps)\n";
+            cout << "Quiescence nodes: " << total.qnodes << " (" << percent(total.qnodes, total.nodes) << "%)\n";
+            cout << "TT probes: " << total.tt_probes << ", hits " << percent(total.tt_hits, total.tt_probes)
+                 << "%, cutoffs " << percent(total.tt_cutoffs, total.tt_probes) << "%\n";
+            cout << "Beta cutoffs: " << total.beta_cutoffs << "\n";
+            for (int i = 0; i < CUTOFF_SLOTS; i++)
+                cout << "\tmove " << i + 1 << (i == CUTOFF_SLOTS - 1 ? "+" : "") << ": "
+                     << total.cutoff_index[i] << " (" << percent(total.cutoff_index[i], total.beta_cutoffs) << "%)\n";
+            cout << "Hashfull: " << engine.tt.hashfull() << " permille\n";
+        }
     }
 
     return 0;
@@ -33,6 +33,11 @@ class bitarray {
         arr += 1 << i;
     }
 
+    // clear bits not in mask
+    inline void operator&=(uint8_t mask) {
+        arr &= mask;
+    }
+
     // get byte
     inline uint8_t to_byte() const {
         return arr;
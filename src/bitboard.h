@@ -90,11 +90,6 @@ inline square get_and_clear_lsb(bitboard& b) {
 }
 
 inline int count_bits(bitboard b) {
-    int count = 0;
-    while (b != 0) {
-        get_and_clear_lsb(b);
-        count ++;
-    }
-    return count;
+    return __builtin_popcountll(b);
 }
 #endif
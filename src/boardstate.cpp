@@ -6,9 +6,12 @@
 #include "transpositions.h"
 #include "zobrist.h"
 #include "logger.h"
+#include <algorithm>
 #include <chrono>
+#include <sstream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 ///////////////////////////////////////////////////////////
 //                     Constructors                      //
@@ -19,26 +22,19 @@ Boardstate::Boardstate() {
     flags = 0;
     enpassant = no_sq;
 
-    board = 0;
     occupancies = {0, 0};
     pieces[WHITE] = {0, 0, 0, 0, 0, 0};
     pieces[BLACK] = {0, 0, 0, 0, 0, 0};
+    piece_on.fill(NULL_PIECE);
 
     hash = 0;
 
     endgame = 0;
     midgame = 0;
-    gamestage = 0;
 
-    no_capture_count = 0;
+    halfmove_clock = 0;
 }
 
-Boardstate::Boardstate(const Boardstate& c):
-    to_move(c.to_move), board(c.board), pieces(c.pieces),
-    occupancies(c.occupancies), flags(c.flags), enpassant(c.enpassant),
-    midgame(c.midgame), endgame(c.endgame), gamestage(c.gamestage),
-    no_capture_count(c.no_capture_count), hash(c.hash) {}
-
 
 ///////////////////////////////////////////////////////////
 //           Make-move and helper functions              //
@@ -52,166 +48,157 @@ inline void Boardstate::swap_to_move() noexcept {
 inline void Boardstate::set_piece(const piece p, const color c, const square i) noexcept {
     bitboard b = 1ull << i;
 
-    board          |= b;
     occupancies[c] |= b;
     pieces[c][p]   |= b;
+    piece_on[i]     = p;
 }
 
 inline void Boardstate::pop_piece(const piece p, const color c, const square i) noexcept {
     bitboard b = ~(1ull << i);
 
-    board          &= b;
     occupancies[c] &= b;
     pieces[c][p]   &= b;
+    piece_on[i]     = NULL_PIECE;
 }
 
-// rook position maps for castling
-const std::unordered_map<square, square> castle_rook_begin {
-    {g1, h1}, {c1, a1}, {g8, h8}, {c8, a8}
-};
-
-const std::unordered_map<square, square> castle_rook_end {
-    {g1, f1}, {c1, d1}, {g8, f8}, {c8, d8}
-};
-
-const std::unordered_map<square, int> castle_id {
-    {a1, 0}, {h1, 1}, {a8, 2}, {h8, 3}
-};
+// rook squares for castling, indexed by king destination square
+constexpr std::array<square, 64> castle_rook_begin = [] {
+    std::array<square, 64> table{};
+    table[g1] = h1; table[c1] = a1; table[g8] = h8; table[c8] = a8;
+    return table;
+}();
+
+constexpr std::array<square, 64> castle_rook_end = [] {
+    std::array<square, 64> table{};
+    table[g1] = f1; table[c1] = d1; table[g8] = f8; table[c8] = d8;
+    return table;
+}();
+
+// castling rights kept after a move from or to each square,
+// a king or rook leaving its square (or a rook being captured) drops them
+constexpr std::array<uint8_t, 64> castle_rights_mask = [] {
+    std::array<uint8_t, 64> table{};
+    for (auto& mask : table)
+        mask = 0xff;
+    table[a1] &= ~(1 << WhiteQueenSideCastle);
+    table[h1] &= ~(1 << WhiteKingSideCastle);
+    table[e1] &= ~(1 << WhiteQueenSideCastle | 1 << WhiteKingSideCastle);
+    table[a8] &= ~(1 << BlackQueenSideCastle);
+    table[h8] &= ~(1 << BlackKingSideCastle);
+    table[e8] &= ~(1 << BlackQueenSideCastle | 1 << BlackKingSideCastle);
+    return table;
+}();
 
 // offsets for calculating enpassant square
-constexpr int enpassant_offset[] = {-8, 8};
+template<color Us>
+constexpr int enpassant_offset = Us == WHITE ? -8 : 8;
 
+template<color Us>
 bool Boardstate::make_move(const Move m) noexcept {
-    // parse move information
+    constexpr color Them = 1 - Us;
+
+    // parse move information, pieces are read from the mailbox
     square src = get_src(m);
     square dest = get_dest(m);
-    piece p = get_piece(m);
-    piece promotion = get_promoted(m);
-    uint8_t move_flags = get_flags(m);
-
-    // clear from bit
-    pop_piece(p, to_move, src);
-    midgame -= midgame_value_map[to_move][p][src];
-    endgame -= endgame_value_map[to_move][p][src];
-    //hash ^= hash_table[to_move][p][src];
+    uint8_t special = get_special(m);
+    piece p = piece_on[src];
+    piece promotion = special == PROMOTION ? get_promoted(m) : p;
+    piece captured = piece_on[dest];
 
-    // set to bit
-    set_piece(promotion, to_move, dest);
-    midgame += midgame_value_map[to_move][promotion][dest];
-    endgame += endgame_value_map[to_move][promotion][dest];
-    //hash ^= hash_table[to_move][promotion][dest];
+    // saturates, only compared against 100
+    halfmove_clock += halfmove_clock < 255;
+    if (p == PAWN)
+        halfmove_clock = 0;
 
-    no_capture_count += 1;
-    //hash ^= enpass_square_hash_table[enpassant];
+    hash ^= enpass_square_hash_table[enpassant];
+    enpassant = no_sq;
 
     // if capture -> clear other bitboards
-    if (move_flags & CAPTURE) {
-        no_capture_count = 0;
-
-        bitboard b;
+    if (captured != NULL_PIECE) {
+        halfmove_clock = 0;
 
-        // if en passant capture
-        if (move_flags & ENPASSANT) {
-            b = 1ull << (dest + enpassant_offset[to_move]);
-            board ^= b;
-            occupancies[1 - to_move] ^= b;
-            pieces[1 - to_move][PAWN] ^= b;
+        pop_piece(captured, Them, dest);
+        midgame -= midgame_value_map[Them][captured][dest];
+        endgame -= endgame_value_map[Them][captured][dest];
+        hash ^= hash_table[Them][captured][dest];
+    }
 
-            midgame -= midgame_value_map[1 - to_move][PAWN][dest + enpassant_offset[to_move]];
-            endgame -= endgame_value_map[1 - to_move][PAWN][dest + enpassant_offset[to_move]];
-            //hash ^= hash_table[1 - to_move][PAWN][dest + enpassant_offset[to_move]];
+    // clear from bit
+    pop_piece(p, Us, src);
+    midgame -= midgame_value_map[Us][p][src];
+    endgame -= endgame_value_map[Us][p][src];
+    hash ^= hash_table[Us][p][src];
 
-            gamestage += gamestage_value_map[PAWN];
-        }
-        else {
-            b = 1ull << dest;
-            occupancies[1 - to_move] ^= b;
-
-            for (piece p = PAWN; p <= QUEEN; p++) {
-                if (pieces[1 - to_move][p] & b) {
-                    pieces[1 - to_move][p] ^= b;
-
-                    midgame -= midgame_value_map[1 - to_move][p][dest];
-                    endgame -= endgame_value_map[1 - to_move][p][dest];
-                    //hash ^= hash_table[1 - to_move][p][dest];
-
-                    gamestage += gamestage_value_map[p];
-                    break;
-                }
-            }
-        }
-        enpassant = no_sq;
-
-        if (move_flags & UNCASTLE) {
-            //hash ^= castle_rights_hash_table[flags.to_byte() & 0xf];
-            if (p == KING) {
-                flags.set(2 * to_move);
-                flags.set(2 * to_move + 1);
-            }
-            else
-                flags.set(castle_id.at(src));
-            //hash ^= castle_rights_hash_table[flags.to_byte() & 0xf];
-        }
+    // set to bit
+    set_piece(promotion, Us, dest);
+    midgame += midgame_value_map[Us][promotion][dest];
+    endgame += endgame_value_map[Us][promotion][dest];
+    hash ^= hash_table[Us][promotion][dest];
+
+    // if en passant capture -> clear pawn behind dest
+    if (special == ENPASSANT) {
+        halfmove_clock = 0;
+
+        square behind = dest + enpassant_offset<Us>;
+        pop_piece(PAWN, Them, behind);
+        midgame -= midgame_value_map[Them][PAWN][behind];
+        endgame -= endgame_value_map[Them][PAWN][behind];
+        hash ^= hash_table[Them][PAWN][behind];
     }
 
-    // if castle -> move rook and set flags
-    else if (move_flags & CASTLE) {
-        square from = castle_rook_begin.at(dest);
-        pop_piece(ROOK, to_move, from);
-        midgame -= midgame_value_map[to_move][ROOK][from];
-        endgame -= endgame_value_map[to_move][ROOK][from];
-        //hash ^= hash_table[to_move][ROOK][from];
-
-        square to = castle_rook_end.at(dest);
-        set_piece(ROOK, to_move, to);
-        midgame += midgame_value_map[to_move][ROOK][to];
-        endgame += endgame_value_map[to_move][ROOK][to];
-        //hash ^= hash_table[to_move][ROOK][to];
-
-        enpassant = no_sq;
-
-        //hash ^= castle_rights_hash_table[flags.to_byte() & 0xf];
-        flags.set(2 * to_move);
-        flags.set(2 * to_move + 1);
-        //hash ^= castle_rights_hash_table[flags.to_byte() & 0xf];
+    // if castle -> move rook
+    else if (special == CASTLE) {
+        square from = castle_rook_begin[dest];
+        pop_piece(ROOK, Us, from);
+        midgame -= midgame_value_map[Us][ROOK][from];
+        endgame -= endgame_value_map[Us][ROOK][from];
+        hash ^= hash_table[Us][ROOK][from];
+
+        square to = castle_rook_end[dest];
+        set_piece(ROOK, Us, to);
+        midgame += midgame_value_map[Us][ROOK][to];
+        endgame += endgame_value_map[Us][ROOK][to];
+        hash ^= hash_table[Us][ROOK][to];
     }
 
-    // if uncastle -> remove castle permisions
-    else if (move_flags & UNCASTLE) {
-        //hash ^= castle_rights_hash_table[flags.to_byte() & 0xf];
-        if (p == KING) {
-            flags.set(2 * to_move);
-            flags.set(2 * to_move + 1);
-        }
-        else
-            flags.set(castle_id.at(src));
-        //hash ^= castle_rights_hash_table[flags.to_byte() & 0xf];
+    // if pawn double push -> set en passant square, only if an enemy pawn can take
+    else if (p == PAWN && (dest > src ? dest - src : src - dest) == 16) {
+        bitboard b = 1ull << dest;
+        if ((eastShiftOne(b) | westShiftOne(b)) & pieces[Them][PAWN])
+            enpassant = dest + enpassant_offset<Us>;
     }
 
-    // if en passant -> set en passant square
-    else if (move_flags & ENPASSANT)
-        enpassant = dest + enpassant_offset[to_move];
-    else
-        enpassant = no_sq;
-    
-    //hash ^= enpass_square_hash_table[enpassant];
+    hash ^= enpass_square_hash_table[enpassant];
+
+    // update castling rights
+    hash ^= castle_rights_hash_table[flags.to_byte() & 0xf];
+    flags &= castle_rights_mask[src] & castle_rights_mask[dest];
+    hash ^= castle_rights_hash_table[flags.to_byte() & 0xf];
 
     // check if move was legal
-    if (is_attacked(*this, lsb(pieces[to_move][KING])))
+    if (is_attacked<Us>(*this, lsb(pieces[Us][KING])))
         return false;
 
-    swap_to_move();
+    to_move = Them;
+    hash ^= side_hash;
 
     // check if enemy king is in check
-    if (is_attacked(*this, lsb(pieces[to_move][KING]))) {
-        //hash ^= check_hash_table[flags.to_byte() >> 4];
-        flags.add(6 - 2 * to_move);
-        //hash ^= check_hash_table[flags.to_byte() >> 4];
+    if (is_attacked<Them>(*this, lsb(pieces[Them][KING]))) {
+        hash ^= check_hash_table[flags.to_byte() >> 4];
+        flags.add(6 - 2 * Them);
+        hash ^= check_hash_table[flags.to_byte() >> 4];
     }
 
     return true;
 }
 
+bool Boardstate::make_move(const Move m) noexcept {
+    return to_move == WHITE ? make_move<WHITE>(m) : make_move<BLACK>(m);
+}
+
+template bool Boardstate::make_move<WHITE>(const Move m) noexcept;
+template bool Boardstate::make_move<BLACK>(const Move m) noexcept;
+
 ///////////////////////////////////////////////////////////
 //           @ <= Performance Critical => @              //
 ///////////////////////////////////////////////////////////
@@ -246,18 +233,17 @@ int Boardstate::get_result() const {
 
 void Boardstate::reset() {
     to_move = WHITE;
-    flags = 0;
+    flags = 0xf;
 
-    board = 0;
     occupancies = {0, 0};
     pieces[WHITE] = {0, 0, 0, 0, 0, 0};
     pieces[BLACK] = {0, 0, 0, 0, 0, 0};
+    piece_on.fill(NULL_PIECE);
 
     endgame = 0;
     midgame = 0;
-    gamestage = 0;
 
-    no_capture_count = 0;
+    halfmove_clock = 0;
 
     // setting white pieces
     set_piece(ROOK, WHITE, a1);
@@ -291,132 +277,282 @@ void Boardstate::reset() {
 }
 
 
+///////////////////////////////////////////////////////////
+//                 Setup from FEN string                 //
+///////////////////////////////////////////////////////////
+
+static const std::unordered_map<char, piece> fen_piece_map = {
+    {'p', PAWN}, {'b', BISHOP}, {'n', KNIGHT}, {'r', ROOK}, {'q', QUEEN}, {'k', KING}
+};
+
+// parses "e3" into a square, no_sq if invalid
+static square parse_square(const std::string& s) {
+    if (s.size() != 2 || s[0] < 'a' || s[0] > 'h' || s[1] < '1' || s[1] > '8')
+        return no_sq;
+    return ('h' - s[0]) + (s[1] - '1') * 8;
+}
+
+// parses a number, -1 if invalid
+static int parse_number(const std::string& s) {
+    if (s.empty() || s.size() > 4)
+        return -1;
+    int x = 0;
+    for (char c : s) {
+        if (c < '0' || c > '9')
+            return -1;
+        x = x * 10 + (c - '0');
+    }
+    return x;
+}
+
+bool Boardstate::set_fen(const std::string& fen) {
+    std::vector<std::string> fields;
+    std::istringstream stream(fen);
+    for (std::string field; stream >> field;)
+        fields.push_back(field);
+
+    if (fields.size() < 4)
+        return false;
+
+    *this = Boardstate();
+
+    // piece placement, from a8 to h1
+    int rank = 7, file = 0;
+    for (char c : fields[0]) {
+        if (c == '/') {
+            if (file != 8 || rank == 0)
+                return false;
+            rank--;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else {
+            auto it = fen_piece_map.find(tolower(c));
+            if (it == fen_piece_map.end() || file > 7)
+                return false;
+
+            color c_color = isupper(c) ? WHITE : BLACK;
+            square sq = rank * 8 + (7 - file);
+            set_piece(it->second, c_color, sq);
+            midgame += midgame_value_map[c_color][it->second][sq];
+            endgame += endgame_value_map[c_color][it->second][sq];
+            file++;
+        }
+        if (file > 8)
+            return false;
+    }
+    if (rank != 0 || file != 8)
+        return false;
+
+    // both sides need exactly one king
+    if (count_bits(pieces[WHITE][KING]) != 1 || count_bits(pieces[BLACK][KING]) != 1)
+        return false;
+
+    // side to move
+    if (fields[1] == "w")
+        to_move = WHITE;
+    else if (fields[1] == "b")
+        to_move = BLACK;
+    else
+        return false;
+
+    // castling rights
+    for (char c : fields[2]) {
+        switch (c) {
+            case 'K': flags.set(WhiteKingSideCastle); break;
+            case 'Q': flags.set(WhiteQueenSideCastle); break;
+            case 'k': flags.set(BlackKingSideCastle); break;
+            case 'q': flags.set(BlackQueenSideCastle); break;
+            case '-': break;
+            default: return false;
+        }
+    }
+
+    // en passant square
+    if (fields[3] != "-") {
+        enpassant = parse_square(fields[3]);
+        if (enpassant == no_sq)
+            return false;
+
+        // kept only if a pawn can take, like make_move does, so the
+        // hash is the same as after the double push itself
+        bitboard b = 0;
+        if (enpassant / 8 == (to_move == WHITE ? 5 : 2))
+            b = 1ull << (to_move == WHITE ? enpassant - 8 : enpassant + 8);
+        if (!((eastShiftOne(b) | westShiftOne(b)) & pieces[to_move][PAWN]))
+            enpassant = no_sq;
+    }
+
+    // optional 3-check counters, then halfmove clock
+    int checks[2] = {0, 0};
+    size_t next = 4;
+    if (next < fields.size() && fields[next].find('+') != std::string::npos) {
+        const std::string& f = fields[next++];
+        size_t plus = f.find('+', 1);
+        if (f[0] == '+' && plus != std::string::npos) {
+            checks[WHITE] = parse_number(f.substr(1, plus - 1));
+            checks[BLACK] = parse_number(f.substr(plus + 1));
+        } else {
+            plus = f.find('+');
+            checks[WHITE] = 3 - parse_number(f.substr(0, plus));
+            checks[BLACK] = 3 - parse_number(f.substr(plus + 1));
+        }
+    }
+
+    if (next < fields.size()) {
+        int halfmoves = parse_number(fields[next++]);
+        if (halfmoves < 0)
+            return false;
+        halfmove_clock = std::min(halfmoves, 255);
+    }
+
+    // skip fullmove number
+    if (next < fields.size())
+        next++;
+
+    // lichess style "+W+B" checks given at the end
+    if (next < fields.size() && fields[next][0] == '+') {
+        const std::string& f = fields[next];
+        size_t plus = f.find('+', 1);
+        if (plus == std::string::npos)
+            return false;
+        checks[WHITE] = parse_number(f.substr(1, plus - 1));
+        checks[BLACK] = parse_number(f.substr(plus + 1));
+    }
+
+    for (color c = WHITE; c <= BLACK; c++) {
+        if (checks[c] < 0 || checks[c] > 3)
+            return false;
+        for (int i = 0; i < checks[c]; i++)
+            flags.add(4 + 2 * c);
+    }
+
+    hash = hash_state(*this);
+    return true;
+}
+
 ///////////////////////////////////////////////////////////
 //      These should only be used by the interface       //
 ///////////////////////////////////////////////////////////
 
-bool Boardstate::player_move(Move m, bool forcing) {
+static std::unordered_map<uint8_t, char> char_map = {
+    {PAWN, 'P'}, {ROOK, 'R'}, {BISHOP, 'B'}, {KNIGHT, 'N'}, {KING, 'K'}, {QUEEN, 'Q'}
+};
+
+bool Boardstate::player_move(SearchContext& engine, Move m, bool forcing) {
     // TODO: check if move is valid
     //       xboard doesn't track castles and enpassant
+    uint64_t previous = hash;
     if (forcing) {
         make_move(m);
+        engine.push_game_history(previous);
         return true;
     } else {
         square src = get_src(m);
         square dest = get_dest(m);
-        uint8_t move_flags = get_flags(m);
-        
-        if((move_flags & CASTLE) && is_attacked(*this, (src + dest) / 2))
+
+        if (get_special(m) == CASTLE && is_attacked(*this, (src + dest) / 2))
+            return false;
+
+        if (!make_move(m))
             return false;
 
-        return make_move(m);
+        engine.push_game_history(previous);
+        return true;
     }
 }
 
-std::string Boardstate::engine_move(uint32_t time, int max_depth) {
-    update_trans_table();
-    
-    Move m;
-    if (max_depth <= 6) {
-        set_search_depth(max_depth);
-        m = search(*this); 
-    } else {
-        uint32_t allocated_time = time / 20;
-        auto start = std::chrono::system_clock::now();
-        
-        for (int depth = 6; depth <= max_depth; depth++) {
-            set_search_depth(depth);
-            m = search(*this);
-
-            auto stop = std::chrono::system_clock::now();
-            uint32_t centis = std::chrono::duration_cast<std::chrono::milliseconds>
-                            (stop - start).count() / 10;
-    
-            log("Searched to depth " + std::to_string(depth) + " in " + 
-                 std::to_string(centis * 10) + "ms");
-            if (centis * 5 > allocated_time)
-                break;
-        }
-    }
+search_limits engine_move_limits(uint32_t time, int max_depth) {
+    // time is in centiseconds, stop deepening after 1% of it
+    // (centis / 10 ms), fixed depth for shallow searches
+    search_limits limits;
+    limits.depth = max_depth;
+    limits.soft_time = max_depth <= 6 ? 0 : time / 10;
+    return limits;
+}
 
-    if (m == 0)
-        return "1/2-1/2 {Stalemate}\n";
+std::string Boardstate::engine_move(SearchContext& engine, uint32_t time, int max_depth,
+                                    const std::function<void(const search_info&)>& report) {
+    search_limits limits = engine_move_limits(time, max_depth);
+    auto start = std::chrono::steady_clock::now();
+    Move m = engine.think(*this, limits, report);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>
+                   (std::chrono::steady_clock::now() - start).count();
+
+    const search_stats& stats = engine.get_stats();
+    log("Searched to depth " + std::to_string(max_depth) + ", score " +
+        std::to_string(engine.get_score()) + ", " + std::to_string(elapsed) + " ms, " +
+        std::to_string(elapsed ? stats.nodes * 1000 / elapsed : 0) + " nps");
+    log(stats_to_str(stats));
+
+    return play_engine_move(engine, m);
+}
 
+std::string Boardstate::play_engine_move(SearchContext& engine, Move m) {
+    if (m == 0) {
+        if (engine.get_score() == 0)
+            return "1/2-1/2 {Stalemate}\n";
+        return to_move == WHITE ?
+               "0-1 {Black Mates}\n":
+               "1-0 {White Mates}\n";
+    }
+
+    uint64_t previous = hash;
     if (!make_move(m))
         return to_move == WHITE ?
                "0-1 {Black Mates}\n":
                "1-0 {White Mates}\n";
 
-    if (no_capture_count >= 50)
-        return "1/2-1/2 {Stalemate}\n";
+    engine.push_game_history(previous);
 
-    square from = get_src(m);
-    square to = get_dest(m);
+    if (halfmove_clock >= 100)
+        return "1/2-1/2 {50 move rule}\n";
 
-    return "move "
-        + std::string(1, (char)(7 - (from % 8) + 'a')) + std::to_string(from / 8 + 1)
-        + std::string(1, (char)(7 - (to % 8) + 'a')) + std::to_string(to / 8 + 1) + '\n';
+    return "move " + move_to_str(m) + '\n';
+}
+
+Move Boardstate::parse_move(const std::string& str) const {
+    square old_poz = ('h' - str[0]) + (str[1] - '1') * 8;
+    square new_poz = ('h' - str[2]) + (str[3] - '1') * 8;
+
+    // get piece type
+    piece p = piece_on[old_poz];
+
+    // set special flag, promotion piece is only stored for promotions
+    if (str.length() == 5) {
+        piece promotion = QUEEN;
+        switch (str[4]) {
+            case 'r': promotion = ROOK; break;
+            case 'b': promotion = BISHOP; break;
+            case 'n': promotion = KNIGHT; break;
+        }
+        return encode(old_poz, new_poz, PROMOTION, promotion);
+    }
+    if (is_castle(old_poz, new_poz, p))
+        return encode(old_poz, new_poz, CASTLE);
+    if (p == PAWN && new_poz == enpassant)
+        return encode(old_poz, new_poz, ENPASSANT);
+    return encode(old_poz, new_poz);
 }
 
 piece Boardstate::get_piece(square i) const {
-    bitboard b = 1ull << i;
-    for (piece p = PAWN; p <= KING; p++)
-        if ((pieces[WHITE][p] & b) || (pieces[BLACK][p] & b))
-            return p;
-    return NULL_PIECE;
+    return piece_on[i];
 }
 
 bool Boardstate::is_castle(square old, square new_poz, piece p) const {
 	// Castling moves:	e1g1, e1c1, e8g8, e8c8
     return p == KING && (
-        (old == e1 && new_poz == g1 && !flags.test(WhiteKingSideCastle)) ||
-        (old == e1 && new_poz == c1 && !flags.test(WhiteQueenSideCastle)) ||
-        (old == e8 && new_poz == g8 && !flags.test(BlackKingSideCastle)) ||
-        (old == e8 && new_poz == c8 && !flags.test(BlackQueenSideCastle))
+        (old == e1 && new_poz == g1 && flags.test(WhiteKingSideCastle)) ||
+        (old == e1 && new_poz == c1 && flags.test(WhiteQueenSideCastle)) ||
+        (old == e8 && new_poz == g8 && flags.test(BlackKingSideCastle)) ||
+        (old == e8 && new_poz == c8 && flags.test(BlackQueenSideCastle))
     );
 }
 
-bool Boardstate::is_rk_init_sq(square pos) const {
-    if (to_move == WHITE && (pos == a1 || pos == h1))
-        return true;
-    if (to_move == BLACK && (pos == a8 || pos == h8))
-        return true;
-    return false;
-}
-
-bool Boardstate::is_enpass(square old, square new_poz, piece p) const {
-    if (p != PAWN)
-        return false;
-
-    if (to_move == WHITE) {
-        if (new_poz - old != 16)
-            return false;
-
-        // TODO board bounds check
-        if (!((1ull << (new_poz + 1) | 1ull << (new_poz - 1)) & pieces[BLACK][PAWN]))
-            return false;
-    }
-    else {
-        if (old - new_poz != 16)
-            return false;
-
-        // TODO board bounds check
-        if (!((1ull << (new_poz + 1) | 1ull << (new_poz - 1)) & pieces[WHITE][PAWN]))
-            return false;
-    }
-
-    return true;
-}
-
-
 ///////////////////////////////////////////////////////////
 //       This is just for pretty logging/debugging       //
 ///////////////////////////////////////////////////////////
 
-static std::unordered_map<uint8_t, char> char_map = {
-    {PAWN, 'P'}, {ROOK, 'R'}, {BISHOP, 'B'}, {KNIGHT, 'N'}, {KING, 'K'}, {QUEEN, 'Q'}
-};
-
 std::string Boardstate::get_state() const {
     std::string output;
 
@@ -430,14 +566,8 @@ std::string Boardstate::get_state() const {
     output += "\nX a  b  c  d  e  f  g  h\n8 ";
     // board
     for (auto i = 63; i >= 0; i--) {
-        if (board & 1ull << i) {
-            for (piece p = PAWN; p <= KING; p++) {
-                if (pieces[WHITE][p] & 1ull << i)
-                    output = output + char_map[p] + "w ";
-                else if (pieces[BLACK][p] & 1ull << i)
-                    output = output + char_map[p] + "b ";
-            }
-        }
+        if (board() & 1ull << i)
+            output = output + char_map[piece_on[i]] + (occupancies[WHITE] & 1ull << i ? "w " : "b ");
         else
             output += ".  ";
 
@@ -446,7 +576,7 @@ std::string Boardstate::get_state() const {
             output = output + '\n' + (i > 0 ? std::to_string(i / 8) + ' ' : "");
     }
     output += "Game result: " + std::to_string(get_result()) + '\n';
-    output += "Game stage: " + std::to_string(gamestage) + '\n';
+    output += "Game stage: " + std::to_string(get_gamestage()) + '\n';
     // these two should always be equal
     output += "Static  Evaluation: " + std::to_string(static_evaluate(*this)) + '\n';
     output += "Rolling Evaluation: " + std::to_string(midgame + endgame) + '\n';
@@ -5,7 +5,14 @@
 #include "move.h"
 #include "bitarray.h"
 #include <array>
+#include <functional>
 #include <string>
+#include <type_traits>
+
+// defined in search.h
+struct search_info;
+struct search_limits;
+class SearchContext;
 
 // Definitions of internal board structure
 
@@ -35,7 +42,11 @@ enum {
   NULL_PIECE
 };
 
-class Boardstate
+// Copied once per node by the copy-make search, so the layout is kept to
+// exactly three cache lines: bitboards first, then the mailbox, then the
+// small fields packed into 8 bytes. Anything derivable cheaply (the full
+// board, the gamestage) is computed on demand instead of being stored.
+class alignas(64) Boardstate
 {
   public:
 
@@ -43,35 +54,34 @@ class Boardstate
     /*             Data              */
     ///////////////////////////////////
 
-    // side to move
-    int to_move;
-
-    // all pieces on the board
-    bitboard board;
-
     // pieces[COLOR][PIECE] -> bitboard of pieces PIECE and color COLOR
     std::array<std::array<bitboard, 6>, 2> pieces;
 
     // occupancies[COLOR] -> all pieces of color COLOR
     std::array<bitboard, 2> occupancies;
 
-    // castling rights and check count
-    bitarray flags;
+    // zobrist hash
+    uint64_t hash;
 
-    // enpassant square
-    square enpassant;
+    // piece_on[SQUARE] -> piece on SQUARE, or NULL_PIECE if empty
+    // kept in sync with the bitboards by set_piece/pop_piece
+    std::array<piece, 64> piece_on;
 
     // evaluation cache
-    int midgame, endgame;
+    int16_t midgame, endgame;
 
-    // gamestage euristic for evaluation
-    int gamestage;
+    // side to move
+    color to_move;
 
-    // no capture moves count, for 50 move rule
-    int no_capture_count;
+    // castling rights (bit set while the right is kept) and check count
+    bitarray flags;
 
-    // zobrist hash
-    uint64_t hash;
+    // enpassant square
+    square enpassant;
+
+    // plies since the last capture or pawn move, for the 50 move rule
+    // and to bound the repetition search
+    uint8_t halfmove_clock;
 
     ///////////////////////////////////
     /*            Methods            */
@@ -80,8 +90,23 @@ class Boardstate
     // default constructor
     Boardstate();
 
-    // copy-constructor for recursion (copy-move)
-    Boardstate(const Boardstate& c);
+    // copy-constructor for recursion (copy-move), a plain memcpy
+    Boardstate(const Boardstate& c) = default;
+    Boardstate& operator=(const Boardstate& c) = default;
+
+    // all pieces on the board
+    inline bitboard board() const {
+        return occupancies[WHITE] | occupancies[BLACK];
+    }
+
+    // gamestage euristic for evaluation, from 0 (all pieces) to 24 (no pieces)
+    inline int get_gamestage() const {
+        int material = count_bits(pieces[WHITE][BISHOP] | pieces[BLACK][BISHOP])
+                     + count_bits(pieces[WHITE][KNIGHT] | pieces[BLACK][KNIGHT])
+                     + count_bits(pieces[WHITE][ROOK] | pieces[BLACK][ROOK]) * 2
+                     + count_bits(pieces[WHITE][QUEEN] | pieces[BLACK][QUEEN]) * 4;
+        return material < 24 ? 24 - material : 0;
+    }
 
     // get string of board state for logging and debugging
     std::string get_state() const;
@@ -89,23 +114,38 @@ class Boardstate
     // reset board to starting position
     void reset();
 
+    // set board from FEN, 3-check counters are read from an optional
+    // "W+B" (checks remaining) field or a trailing "+W+B" (checks given)
+    // returns false if the string is malformed
+    bool set_fen(const std::string& fen);
+
     // applies pseudo-legal move m to boardstate
     // if m is not legal, returns false
     // non-reversible (copy-make)
     bool make_move(Move m) noexcept;
 
+    // same as above, with side to move Us known at compile time
+    template<color Us> bool make_move(Move m) noexcept;
+
     // returns 0 if game is still going,
     //         1 if white 3-checked
     //         2 if black 3-checked
     int get_result() const;
 
-    // methods used only by interface
-    bool player_move(Move m, bool forcing);
-    std::string engine_move(uint32_t time, int max_depth);
+    // methods used only by interface, the moves played are added to
+    // the game history of engine
+    bool player_move(SearchContext& engine, Move m, bool forcing);
+    std::string engine_move(SearchContext& engine, uint32_t time, int max_depth,
+                            const std::function<void(const search_info&)>& report = nullptr);
+
+    // plays m, the result of a search of this position, and returns the
+    // xboard reply (move or game result)
+    std::string play_engine_move(SearchContext& engine, Move m);
     piece get_piece(square i) const;
+
+    // move in coordinate notation (e2e4, e7e8q), str has to be well formed
+    Move parse_move(const std::string& str) const;
     bool is_castle(square old, square new_poz, piece p) const;
-    bool is_enpass(square old, square new_poz, piece p) const;
-    bool is_rk_init_sq(square pos) const;
 
 
   private:
@@ -115,4 +155,12 @@ class Boardstate
     void swap_to_move() noexcept;
 
 };
+
+// limits of engine_move, time in centiseconds; pondering uses them too
+// so a ponder hit ends like the search it replaces
+search_limits engine_move_limits(uint32_t time, int max_depth);
+
+static_assert(sizeof(Boardstate) == 192, "Boardstate should fit in 3 cache lines");
+static_assert(std::is_trivially_copyable<Boardstate>::value, "Boardstate is copied with memcpy");
+
 #endif
@@ -0,0 +1,58 @@
+#ifndef _BOOK_H_
+#define _BOOK_H_
+
+#include "boardstate.h"
+#include "move.h"
+#include <string>
+#include <vector>
+
+// Polyglot opening books: 16 byte big endian entries (key, move, weight,
+// learn) sorted by key. The key is the standard Polyglot one, with its
+// own random table so books work across engines whatever our zobrist
+// seed is; like other 3-check books in this format the check counts are
+// not part of it.
+
+// Polyglot key of B
+uint64_t polyglot_key(const Boardstate& B);
+
+struct book_move {
+    Move move;
+    uint16_t weight;
+};
+
+// a memory mapped book, lookups are binary searches in the file
+class Book
+{
+  public:
+    Book() = default;
+    ~Book();
+    Book(const Book&) = delete;
+    Book& operator=(const Book&) = delete;
+
+    // replaces the open book, false if path is missing or not a book
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const;
+
+    // number of entries
+    size_t size() const;
+
+    // legal book moves of B in file order, usually best first
+    std::vector<book_move> probe(const Boardstate& B) const;
+
+    // book move chosen with probability proportional to its weight,
+    // random is any 64 bit random number; 0 if B is not in the book
+    Move pick(const Boardstate& B, uint64_t random) const;
+
+  private:
+    const unsigned char* data = nullptr;
+    size_t count = 0;
+};
+
+// engine make-book OUTPUT PGN... [--max-ply N] [--min-games N]
+// builds a book from the first plies of the games of pgn files, moves
+// are weighted 2 per win and 1 per draw of the side playing them;
+// returns the exit code
+int make_book(int argc, char* argv[]);
+
+#endif
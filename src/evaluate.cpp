@@ -224,7 +224,7 @@ void init_eval_tables() {
 int evaluate(const Boardstate& B) {
    int check = check_value_map[B.flags.to_byte() >> 4];
 
-   int end = B.gamestage;
+   int end = B.get_gamestage();
    int mid = 24 - end;
    
    return check + (mid * B.midgame + end * B.endgame) / 24;
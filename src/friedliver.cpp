@@ -0,0 +1,160 @@
+#include "friedliver.h"
+#include "boardstate.h"
+#include "evaluate.h"
+#include "move.h"
+#include "move_gen.h"
+#include "search.h"
+#include "zobrist.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+#define DEFAULT_HASH 16
+
+struct fl_context {
+    SearchContext engine;
+    Boardstate position;
+
+    explicit fl_context(size_t hash_mb) : engine(hash_mb) {}
+};
+
+// the shared tables, seeded like the engine so hashes (and the bench
+// signature) are the same in and out of the library
+static void init_tables() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+        init_move_tables();
+        init_eval_tables();
+        init_zobrist_table(0x0);
+    });
+}
+
+static void copy_move(char* dest, Move m) {
+    std::snprintf(dest, 6, "%s", m ? move_to_str(m).c_str() : "");
+}
+
+int fl_api_version(void) {
+    return FL_API_VERSION;
+}
+
+fl_context* fl_create(size_t hash_mb) {
+    init_tables();
+
+    fl_context* ctx = new fl_context(hash_mb ? hash_mb : DEFAULT_HASH);
+    ctx->position.reset();
+    return ctx;
+}
+
+void fl_destroy(fl_context* ctx) {
+    delete ctx;
+}
+
+void fl_new_game(fl_context* ctx) {
+    ctx->engine.tt.clear();
+    ctx->engine.clear_game_history();
+    ctx->engine.clear_move_stats();
+    ctx->position.reset();
+}
+
+int fl_set_position(fl_context* ctx, const char* fen, const char* moves) {
+    Boardstate B;
+    if (!fen)
+        B.reset();
+    else if (!B.set_fen(fen))
+        return FL_INVALID_FEN;
+
+    ctx->position = B;
+    ctx->engine.clear_game_history();
+    if (!moves)
+        return FL_OK;
+
+    std::istringstream stream(moves);
+    std::string token;
+    while (stream >> token) {
+        move_list legal;
+        generate_legal_moves(ctx->position, legal);
+        Move m = 0;
+        for (auto list : {&legal.captures, &legal.quiet})
+            for (auto n : *list)
+                if (move_to_str(n) == token)
+                    m = n;
+        if (m == 0)
+            return FL_ILLEGAL_MOVE;
+
+        ctx->engine.push_game_history(ctx->position.hash);
+        ctx->position.make_move(m);
+    }
+    return FL_OK;
+}
+
+int fl_search(fl_context* ctx, const fl_limits* limits, fl_result* result) {
+    if (!limits || !result)
+        return FL_INVALID_ARGUMENT;
+
+    search_limits search;
+    if (limits->depth > 0)
+        search.depth = std::min(limits->depth, MAX_PLY - 1);
+    search.nodes = limits->nodes;
+    search.hard_time = limits->time_ms;
+
+    // an fl_stop is for the search running when it is called,
+    // one that came in between searches is dropped here
+    ctx->engine.set_stop(false);
+
+    const Boardstate& B = ctx->position;
+    search_info last = {};
+    Move m = ctx->engine.think(B, search, [&last](const search_info& info) {
+        if (info.multipv == 1)
+            last = info;
+    });
+
+    std::memset(result, 0, sizeof(*result));
+    copy_move(result->best_move, m);
+
+    // side to move relative, like the protocols
+    int score = B.to_move == WHITE ? ctx->engine.get_score() : -ctx->engine.get_score();
+    if (score > MATE_BOUND)
+        result->mate = (MATE_SCORE - score + 1) / 2;
+    else if (score < -MATE_BOUND)
+        result->mate = -(MATE_SCORE + score + 1) / 2;
+    else
+        result->score = score;
+
+    result->depth = last.depth;
+    result->nodes = ctx->engine.get_stats().nodes;
+    result->time_ms = last.time;
+    result->pv_length = std::min((int)last.pv.size(), FL_MAX_PV);
+    for (int i = 0; i < result->pv_length; i++)
+        copy_move(result->pv[i], last.pv[i]);
+    return FL_OK;
+}
+
+void fl_stop(fl_context* ctx) {
+    ctx->engine.set_stop(true);
+}
+
+int fl_legal_moves(const fl_context* ctx, char (*moves)[6], int max) {
+    // in generation order, captures first
+    move_list legal;
+    generate_legal_moves(ctx->position, legal);
+    int count = 0;
+    for (auto list : {&legal.captures, &legal.quiet})
+        for (auto m : *list)
+            if (count++ < max)
+                copy_move(moves[count - 1], m);
+    return count;
+}
+
+uint64_t fl_perft(const fl_context* ctx, int depth) {
+    if (depth <= 0)
+        return 1;
+    return perft(ctx->position, depth);
+}
+
+int fl_evaluate(const fl_context* ctx) {
+    int score = evaluate(ctx->position);
+    return ctx->position.to_move == WHITE ? score : -score;
+}
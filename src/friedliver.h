@@ -0,0 +1,97 @@
+#ifndef _FRIEDLIVER_H_
+#define _FRIEDLIVER_H_
+
+/*
+    C API of libfriedliver, the engine without a protocol front-end.
+
+    Every fl_context is an independent game (board, transposition table,
+    search state), contexts can be used from different threads at the
+    same time but one context only from one thread at a time (except
+    fl_stop). Moves are in coordinate notation (e2e4, e7e8q), scores are
+    centipawns from the point of view of the side to move.
+
+    Only functions and structs of this header are exported, new fields
+    are only ever added at the end of the structs and FL_API_VERSION is
+    raised on every change.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define FL_API __attribute__((visibility("default")))
+#else
+#define FL_API
+#endif
+
+#define FL_API_VERSION 1
+#define FL_MAX_PV 64
+
+typedef struct fl_context fl_context;
+
+// zero for no limit, a search without any limit goes to the maximum depth
+typedef struct fl_limits {
+    int depth;
+    uint64_t nodes;
+    uint32_t time_ms;
+} fl_limits;
+
+typedef struct fl_result {
+    char best_move[6];          // empty if the side to move has no moves
+    int score;                  // centipawns, meaningless if mate != 0
+    int mate;                   // moves to mate, negative if the side to move gets mated
+    int depth;                  // last completed iteration
+    uint64_t nodes;
+    uint32_t time_ms;
+    int pv_length;
+    char pv[FL_MAX_PV][6];
+} fl_result;
+
+enum {
+    FL_OK = 0,
+    FL_INVALID_FEN = -1,
+    FL_ILLEGAL_MOVE = -2,
+    FL_INVALID_ARGUMENT = -3
+};
+
+FL_API int fl_api_version(void);
+
+// a context with hash_mb megabytes of transposition table (16 if 0),
+// set to the starting position; like the engine, the library is built
+// without exceptions and running out of memory aborts
+FL_API fl_context* fl_create(size_t hash_mb);
+FL_API void fl_destroy(fl_context* ctx);
+
+// new game: clears the table, history and move ordering tables
+FL_API void fl_new_game(fl_context* ctx);
+
+// fen (NULL for the starting position, 3-check counters optional)
+// followed by the space separated moves (may be NULL); on error the
+// context keeps the position reached before the failing part
+FL_API int fl_set_position(fl_context* ctx, const char* fen, const char* moves);
+
+// searches the current position, blocks until a limit is hit or
+// fl_stop is called from another thread, a stop sent while no search
+// is running doesn't carry over to the next one
+FL_API int fl_search(fl_context* ctx, const fl_limits* limits, fl_result* result);
+FL_API void fl_stop(fl_context* ctx);
+
+// legal moves of the current position, writes at most max of them
+// and returns how many there are
+FL_API int fl_legal_moves(const fl_context* ctx, char (*moves)[6], int max);
+
+// leaf nodes of the current position at depth, 3-check wins are not terminal
+FL_API uint64_t fl_perft(const fl_context* ctx, int depth);
+
+// static evaluation of the current position
+FL_API int fl_evaluate(const fl_context* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
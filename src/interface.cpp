@@ -1,25 +1,60 @@
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
 #include "evaluate.h"
 #include "interface.h"
 #include "logger.h"
 #include "boardstate.h"
+#include "book.h"
 #include "move.h"
 #include "move_gen.h"
+#include "search.h"
 #include "transpositions.h"
 #include "zobrist.h"
 
 #define UNUSED(x) (void)(x) // mark args as redundant to silence compiler warnings
 #define output std::cout
-#define feature_args "feature variants=\"3check\" sigint=0 san=0 name=1 myname=\"FriedLiver\" done=1\n"
+#define feature_args "feature variants=\"3check\" sigint=0 san=0 name=1 myname=\"FriedLiver\" " \
+                     "option=\"MultiPV -spin 1 1 16\" option=\"OwnBook -check 0\" " \
+                     "option=\"BookFile -file \" option=\"HashFile -file \" " \
+                     "option=\"SaveHash -button\" option=\"LoadHash -button\" done=1\n"
+#define MAX_MULTIPV 16
 #define MAX_DEPTH 6
 
 std::map<std::string, void (*)(std::string args)> commands;
 Boardstate game;
+std::unique_ptr<SearchContext> engine;	// search state of the game
 bool forcing = false;
+bool posting = false;
+int multipv = 1;			// lines shown in analyze mode
+
+// OwnBook: moves of the BookFile are played without searching
+Book book;
+bool own_book = false;
+std::mt19937_64 book_random{std::random_device{}()};
+
+// transposition table snapshot written and read by SaveHash / LoadHash
+std::string hash_file;
 uint32_t time_remaining;
 
+// pondering (hard/easy), the predicted reply is searched on
+// ponder_thread while the opponent thinks
+bool ponder_enabled = false;
+std::thread ponder_thread;
+Move ponder_move = 0;		// predicted reply, 0 if not pondering
+Move ponder_result = 0;		// written by ponder_thread, read after join
+
+// analyze mode, the search runs on analysis_thread until stopped
+bool analyzing = false;
+std::thread analysis_thread;
+std::mutex info_mutex;
+search_info last_info;
+
 bool is_move(std::string str) {
 	/* From gnu chess interface
 	standard:
@@ -65,8 +100,115 @@ bool is_move(std::string str) {
 	return true;
 };
 
+///////////////////////////////////////////////////////////
+//                   Thinking output                     //
+///////////////////////////////////////////////////////////
+
+// centipawns for the side to move, mates as 100000 + moves to mate
+int xboard_score(int score, color to_move) {
+	if (to_move == BLACK)
+		score = -score;
+	if (score > MATE_BOUND)
+		return 100000 + (MATE_SCORE - score + 1) / 2;
+	if (score < -MATE_BOUND)
+		return -100000 - (MATE_SCORE + score + 1) / 2;
+	return score;
+}
+
+// ply score time nodes pv, time in centiseconds
+void print_thinking(const search_info& info, color to_move) {
+	std::string line = std::to_string(info.depth) + " "
+		+ std::to_string(xboard_score(info.score, to_move)) + " "
+		+ std::to_string(info.time / 10) + " "
+		+ std::to_string(info.nodes);
+	for (auto m : info.pv)
+		line += " " + move_to_str(m);
+
+	output << line + "\n" << std::flush;
+}
+
+void start_analysis() {
+	Boardstate position = game;
+	engine->set_stop(false);
+	search_limits limits;
+	limits.multipv = multipv;
+	analysis_thread = std::thread([position, limits]() {
+		engine->think(position, limits, [&position](const search_info& info) {
+			{
+				std::lock_guard<std::mutex> lock(info_mutex);
+				last_info = info;
+			}
+			print_thinking(info, position.to_move);
+		});
+	});
+}
+
+void stop_analysis() {
+	if (analysis_thread.joinable()) {
+		engine->set_stop(true);
+		analysis_thread.join();
+		engine->set_stop(false);
+	}
+}
+
+// searches the position after the predicted reply (the tt move)
+// until the opponent moves
+void start_pondering() {
+	if (!ponder_enabled || forcing || analyzing)
+		return;
+
+	auto pv = engine->get_pv(game, 1);
+	if (pv.empty())
+		return;
+
+	Boardstate position = game;
+	if (!position.make_move(pv[0]) || position.get_result() != 0)
+		return;
+
+	ponder_move = pv[0];
+	engine->push_game_history(game.hash);
+	engine->set_stop(false);
+
+	// the limits of a normal move, the clock only starts at the ponder hit
+	search_limits limits = engine_move_limits(time_remaining, MAX_DEPTH);
+	limits.soft_time = limits.hard_time = 0;
+
+	bool post = posting;
+	ponder_thread = std::thread([position, limits, post]() {
+		ponder_result = engine->think(position, limits, [&position, post](const search_info& info) {
+			if (post)
+				print_thinking(info, position.to_move);
+		});
+	});
+}
+
+// ponder miss (or new game, force, ...), the result is thrown away
+void stop_pondering() {
+	if (ponder_thread.joinable()) {
+		engine->set_stop(true);
+		ponder_thread.join();
+		engine->set_stop(false);
+		engine->set_time(0, 0);
+		engine->pop_game_history();
+	}
+	ponder_move = 0;
+}
+
+// ponder hit, the search continues with the time limits of engine_move
+Move finish_pondering() {
+	search_limits limits = engine_move_limits(time_remaining, MAX_DEPTH);
+	engine->set_time(limits.soft_time, limits.hard_time);
+	ponder_thread.join();
+	engine->set_time(0, 0);
+	engine->pop_game_history();
+	ponder_move = 0;
+	return ponder_result;
+}
+
 void quit(std::string args) {
 	UNUSED(args);
+	stop_pondering();
+	stop_analysis();
 	exit(0);
 }
 
@@ -83,52 +225,73 @@ void protover(std::string args) {
 
 void new_game(std::string args) {
 	UNUSED(args);
+	stop_pondering();
+	stop_analysis();
+	analyzing = false;
 	game.reset();
-	clear_trans_table();
+	engine->tt.clear();
+	engine->clear_game_history();
 	forcing = false;
 	log(game.get_state());
 }
 
-void move(std::string args) {
-	// get move poz index
-	square old_poz = ('h' - args[0]) + (args[1] - '1') * 8;
-	square new_poz = ('h' - args[2]) + (args[3] - '1') * 8;
-
-	// get piece type
-	piece p = game.get_piece(old_poz);
-
-	// check for promotion
-	piece promotion = p;
-	if (args.length() == 5) {
-		switch (args[4]) {
-			case 'q': promotion = QUEEN; break;
-			case 'r': promotion = ROOK; break;
-			case 'b': promotion = BISHOP; break;
-			case 'n': promotion = KNIGHT; break;
+// book move, or engine move with thinking output if post is on
+std::string think_and_move() {
+	if (own_book) {
+		Move m = book.pick(game, book_random());
+		if (m) {
+			log("Book move " + move_to_str(m));
+			return game.play_engine_move(*engine, m);
 		}
 	}
 
-	// set flags
-	uint8_t flags = 0;
-	if (game.get_piece(new_poz) != NULL_PIECE)     					flags |= CAPTURE;
-	else if (game.is_castle(old_poz, new_poz, p))  					flags |= CASTLE;
-	else if (game.is_enpass(old_poz, new_poz, p))  					flags |= ENPASSANT;
-	else if (new_poz == game.enpassant)            					flags |= ENPASSANT + CAPTURE;
-	if ((p == ROOK && game.is_rk_init_sq(old_poz)) || p == KING)  	flags |= UNCASTLE;
+	color to_move = game.to_move;
+	if (!posting)
+		return game.engine_move(*engine, time_remaining, MAX_DEPTH);
 
-	// create move
-	Move m = encode(old_poz, new_poz, p, promotion, flags);
+	return game.engine_move(*engine, time_remaining, MAX_DEPTH, [to_move](const search_info& info) {
+		print_thinking(info, to_move);
+	});
+}
+
+void move(std::string args) {
+	Move m = game.parse_move(args);
+
+	// in analyze mode the move is forced, then the new position is analyzed
+	if (analyzing) {
+		stop_analysis();
+		game.player_move(*engine, m, true);
+		log(game.get_state());
+		start_analysis();
+		return;
+	}
+
+	// the opponent played the predicted move, use the ponder search
+	if (ponder_move != 0 && m == ponder_move && !forcing) {
+		Move reply = finish_pondering();
+		game.player_move(*engine, m, false);
+		log(game.get_state());
+
+		std::string engine_move = game.play_engine_move(*engine, reply);
+		log("Engine move (ponder hit) " + engine_move);
+		output << engine_move;
+		log(game.get_state());
+		start_pondering();
+		return;
+	}
+	stop_pondering();
 
 	// pass move to gamestate
-	if (game.player_move(m, forcing)) {
+	if (game.player_move(*engine, m, forcing)) {
 		log(game.get_state());
 
 		// tell engine to make a move
 		if (not forcing) {
-			std::string engine_move = game.engine_move(time_remaining, MAX_DEPTH);
+			std::string engine_move = think_and_move();
 			log("Engine move " + engine_move);
 			output << engine_move;
 			log(game.get_state());
+			start_pondering();
 		}
 	}
 	else
@@ -137,6 +300,7 @@ void move(std::string args) {
 
 void force(std::string args) {
 	UNUSED(args);
+	stop_pondering();
 	forcing = true;
 }
 
@@ -145,10 +309,12 @@ void go(std::string args) {
 	forcing = false;
 
 	// tell engine to make a move
-	std::string engine_move = game.engine_move(time_remaining, MAX_DEPTH);
+	stop_pondering();
+	std::string engine_move = think_and_move();
 	log("Engine move " + engine_move);
 	output << engine_move;
 	log(game.get_state());
+	start_pondering();
 }
 
 void resign(std::string args) {
@@ -156,12 +322,105 @@ void resign(std::string args) {
 	output << "resign\n";
 }
 
+void post(std::string args) {
+	UNUSED(args);
+	posting = true;
+}
+
+void nopost(std::string args) {
+	UNUSED(args);
+	posting = false;
+}
+
+void hard(std::string args) {
+	UNUSED(args);
+	ponder_enabled = true;
+}
+
+void easy(std::string args) {
+	UNUSED(args);
+	ponder_enabled = false;
+	stop_pondering();
+}
+
+void analyze(std::string args) {
+	UNUSED(args);
+	stop_pondering();
+	stop_analysis();
+	analyzing = true;
+	start_analysis();
+}
+
+void exit_analysis(std::string args) {
+	UNUSED(args);
+	stop_analysis();
+	analyzing = false;
+}
+
+// status update: time nodes ply mvleft mvtot, of the last finished iteration
+void analysis_status(std::string args) {
+	UNUSED(args);
+	if (!analyzing)
+		return;
+
+	std::lock_guard<std::mutex> lock(info_mutex);
+	output << "stat01: " + std::to_string(last_info.time / 10) + " "
+		+ std::to_string(last_info.nodes) + " "
+		+ std::to_string(last_info.depth) + " 0 0\n" << std::flush;
+}
+
+// option NAME=VALUE, or option NAME for buttons,
+// for the options sent with the features
+void option(std::string args) {
+	auto start = args.find(' ') + 1;
+	auto eq = args.find('=');
+	std::string name = args.substr(start, eq == std::string::npos ? std::string::npos : eq - start);
+	std::string value = eq == std::string::npos ? "" : args.substr(eq + 1);
+
+	if (name == "MultiPV") {
+		int lines = 0;
+		for (char c : value)
+			if (c >= '0' && c <= '9')
+				lines = std::min(lines * 10 + (c - '0'), MAX_MULTIPV);
+
+		multipv = std::max(lines, 1);
+		if (analyzing) {
+			stop_analysis();
+			start_analysis();
+		}
+	}
+	else if (name == "OwnBook") {
+		own_book = value == "1";
+	}
+	else if (name == "BookFile") {
+		if (value.empty())
+			book.close();
+		else if (!book.open(value))
+			log("Could not open book " + value);
+	}
+	else if (name == "HashFile") {
+		hash_file = value;
+	}
+	else if (name == "SaveHash" || name == "LoadHash") {
+		stop_pondering();
+		stop_analysis();
+		bool saving = name == "SaveHash";
+		bool ok = !hash_file.empty() && (saving ? engine->tt.save(hash_file) : engine->tt.load(hash_file));
+		output << "telluser " << (ok ? (saving ? "saved hash to " : "loaded hash from ")
+		                     : (saving ? "could not save hash to " : "could not load hash from "))
+		       << (hash_file.empty() ? "(no HashFile set)" : hash_file) << "\n" << std::flush;
+		if (analyzing)
+			start_analysis();
+	}
+}
+
 void time(std::string args) {
 	time_remaining = std::stoi(args.substr(args.find(' ')));
 	log("TIME: " + std::to_string(time_remaining));
 }
 
 void init_interface() {
+	engine = std::make_unique<SearchContext>();
 	commands["protover"] = protover;
 	commands["new"] = new_game;
 	commands["force"] = force;
@@ -170,6 +429,14 @@ void init_interface() {
 	commands["resign"] = resign;
 	commands["move"] = move;
 	commands["time"] = time;
+	commands["option"] = option;
+	commands["post"] = post;
+	commands["nopost"] = nopost;
+	commands["hard"] = hard;
+	commands["easy"] = easy;
+	commands["analyze"] = analyze;
+	commands["exit"] = exit_analysis;
+	commands["."] = analysis_status;
 }
 
 void execute(std::string cmd, std::string args) {
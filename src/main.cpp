@@ -1,21 +1,46 @@
+#include <cstdlib>
 #include <iostream>
 #include <string>
+#include "analyze.h"
+#include "bench.h"
+#include "book.h"
 #include "logger.h"
 #include "interface.h"
+#include "uci.h"
 
 #define input std::cin
 
-int main() {
+int main(int argc, char* argv[]) {
+	// engine bench [DEPTH], runs without a gui
+	if (argc > 1 && std::string(argv[1]) == "bench") {
+		bench(argc > 2 ? std::atoi(argv[2]) : BENCH_DEPTH);
+		return 0;
+	}
+
+	// engine analyze-epd FILE [OPTIONS], see analyze.h
+	if (argc > 1 && std::string(argv[1]) == "analyze-epd")
+		return analyze_epd(argc, argv);
+
+	// engine make-book OUTPUT PGN... [OPTIONS], see book.h
+	if (argc > 1 && std::string(argv[1]) == "make-book")
+		return make_book(argc, argv);
+
 	init_logger("log.txt");
-	init_interface();
 	std::string cmd;
 
 	std::getline(input, cmd);
+	if (cmd == "uci") {
+		uci_loop();
+		exit_logger();
+		return 0;
+	}
+
 	if (cmd != "xboard") {
-		log("Not connected to xboard. Aborting...");
+		log("Not connected to xboard or uci. Aborting...");
 		return -1;
 	}
 
+	init_interface();
 	while(std::getline(input, cmd)) {
 		log("xboard: " + cmd);
 
@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "boardstate.h"
+#include "evaluate.h"
+#include "move.h"
+#include "move_gen.h"
+#include "perf_counters.h"
+#include "zobrist.h"
+
+using namespace std;
+
+// Times the hot kernels one at a time over a corpus of positions: the bench
+// positions and every position one legal move away from them. A sample is one
+// pass of a kernel over the whole corpus, reported per call (ns/op).
+
+#define DEFAULT_WARMUP 20
+#define DEFAULT_SAMPLES 200
+
+struct corpus {
+    vector<Boardstate> positions;
+    // (position index, move) for every pseudo legal move of the corpus
+    vector<pair<int, Move>> moves;
+};
+
+// results are summed into a sink so the calls can't be optimized away
+typedef uint64_t (*kernel_fn)(const corpus& C);
+
+uint64_t run_make_move(const corpus& C) {
+    uint64_t sink = 0;
+    for (auto& [i, m] : C.moves) {
+        Boardstate B = C.positions[i];
+        sink += B.make_move(m);
+        sink += B.hash;
+    }
+    return sink;
+}
+
+uint64_t run_is_attacked(const corpus& C) {
+    uint64_t sink = 0;
+    for (auto& B : C.positions)
+        for (square sq = 0; sq < 64; sq++)
+            sink += is_attacked(B, sq);
+    return sink;
+}
+
+uint64_t run_generate_all_moves(const corpus& C) {
+    uint64_t sink = 0;
+    move_list moves;
+    for (auto& B : C.positions) {
+        moves.clear();
+        generate_all_moves(B, moves);
+        sink += moves.captures.count + moves.quiet.count;
+    }
+    return sink;
+}
+
+uint64_t run_generate_capture_moves(const corpus& C) {
+    uint64_t sink = 0;
+    move_array<MAX_MOVES> moves;
+    for (auto& B : C.positions) {
+        moves.clear();
+        generate_capture_moves(B, moves);
+        sink += moves.count;
+    }
+    return sink;
+}
+
+uint64_t run_evaluate(const corpus& C) {
+    uint64_t sink = 0;
+    for (auto& B : C.positions)
+        sink += evaluate(B);
+    return sink;
+}
+
+uint64_t run_hash_state(const corpus& C) {
+    uint64_t sink = 0;
+    for (auto& B : C.positions)
+        sink += hash_state(B);
+    return sink;
+}
+
+struct kernel {
+    string name;
+    kernel_fn run;
+    // calls made by one pass over the corpus
+    uint64_t (*ops)(const corpus& C);
+};
+
+const kernel kernels[] = {
+    {"make_move", run_make_move, [](const corpus& C) { return (uint64_t)C.moves.size(); }},
+    {"is_attacked", run_is_attacked, [](const corpus& C) { return (uint64_t)C.positions.size() * 64; }},
+    {"generate_all_moves", run_generate_all_moves, [](const corpus& C) { return (uint64_t)C.positions.size(); }},
+    {"generate_capture_moves", run_generate_capture_moves, [](const corpus& C) { return (uint64_t)C.positions.size(); }},
+    {"evaluate", run_evaluate, [](const corpus& C) { return (uint64_t)C.positions.size(); }},
+    {"hash_state", run_hash_state, [](const corpus& C) { return (uint64_t)C.positions.size(); }},
+};
+
+corpus build_corpus() {
+    corpus C;
+    for (int i = 0; i < bench_position_count; i++) {
+        Boardstate root;
+        if (!root.set_fen(bench_positions[i]))
+            continue;
+        C.positions.push_back(root);
+
+        move_list moves;
+        generate_all_moves(root, moves);
+        for (auto list : {&moves.captures, &moves.quiet})
+            for (auto m : *list) {
+                Boardstate B = root;
+                if (B.make_move(m) && B.get_result() == 0)
+                    C.positions.push_back(B);
+            }
+    }
+
+    move_list moves;
+    for (int i = 0; i < (int)C.positions.size(); i++) {
+        moves.clear();
+        generate_all_moves(C.positions[i], moves);
+        for (auto list : {&moves.captures, &moves.quiet})
+            for (auto m : *list)
+                C.moves.push_back({i, m});
+    }
+    return C;
+}
+
+struct result {
+    string name;
+    uint64_t ops;
+    double min, p50, p90, p99, mean;
+    // hardware counters over all samples, divided by ops later
+    perf_values perf;
+};
+
+result measure(const kernel& k, const corpus& C, int warmup, int samples, uint64_t& sink,
+               perf_counters& counters) {
+    uint64_t ops = k.ops(C);
+    for (int i = 0; i < warmup; i++)
+        sink += k.run(C);
+
+    vector<double> ns(samples);
+    counters.start();
+    for (int i = 0; i < samples; i++) {
+        auto start = chrono::steady_clock::now();
+        sink += k.run(C);
+        auto stop = chrono::steady_clock::now();
+        ns[i] = (double)chrono::duration_cast<chrono::nanoseconds>(stop - start).count() / ops;
+    }
+    counters.stop();
+
+    sort(ns.begin(), ns.end());
+    auto percentile = [&ns](int p) { return ns[min((size_t)(ns.size() * p / 100), ns.size() - 1)]; };
+    double total = 0;
+    for (auto x : ns)
+        total += x;
+
+    return {k.name, ops, ns[0], percentile(50), percentile(90), percentile(99), total / samples,
+            counters.read()};
+}
+
+int main(int argc, char* argv[]) {
+    int warmup = DEFAULT_WARMUP, samples = DEFAULT_SAMPLES;
+    bool json = false;
+    vector<string> selected;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--warmup" && i + 1 < argc)
+            warmup = max(atoi(argv[++i]), 0);
+        else if (arg == "--samples" && i + 1 < argc)
+            samples = max(atoi(argv[++i]), 1);
+        else if (arg == "--json")
+            json = true;
+        else if (arg[0] == '-') {
+            cout << "Usage: " + string(argv[0]) + " [--warmup N] [--samples N] [--json] [KERNEL...]\n";
+            cout << "Kernels:";
+            for (auto& k : kernels)
+                cout << " " << k.name;
+            cout << "\n";
+            return 0;
+        }
+        else
+            selected.push_back(arg);
+    }
+
+    init_move_tables();
+    init_eval_tables();
+    init_zobrist_table(0x0);
+    corpus C = build_corpus();
+
+    uint64_t sink = 0;
+    perf_counters counters;
+    vector<result> results;
+    for (auto& k : kernels)
+        if (selected.empty() || find(selected.begin(), selected.end(), k.name) != selected.end())
+            results.push_back(measure(k, C, warmup, samples, sink, counters));
+
+    if (json) {
+        cout << "{\"positions\": " << C.positions.size() << ", \"warmup\": " << warmup
+             << ", \"samples\": " << samples << ", \"kernels\": [";
+        for (size_t i = 0; i < results.size(); i++) {
+            auto& r = results[i];
+            char line[256];
+            snprintf(line, sizeof(line),
+                     "%s\n  {\"name\": \"%s\", \"ops\": %llu, \"min_ns\": %.2f, \"p50_ns\": %.2f, "
+                     "\"p90_ns\": %.2f, \"p99_ns\": %.2f, \"mean_ns\": %.2f",
+                     i ? "," : "", r.name.c_str(), (unsigned long long)r.ops,
+                     r.min, r.p50, r.p90, r.p99, r.mean);
+            cout << line;
+
+            // per call, only the counters the kernel let us open
+            static const char* names[PERF_COUNTERS] = {
+                "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses"
+            };
+            uint64_t calls = r.ops * samples;
+            for (int c = 0; c < PERF_COUNTERS; c++)
+                if (r.perf.valid[c]) {
+                    snprintf(line, sizeof(line), ", \"%s\": %.2f", names[c], (double)r.perf.count[c] / calls);
+                    cout << line;
+                }
+            cout << "}";
+        }
+        cout << "\n], \"checksum\": " << sink << "}\n";
+        return 0;
+    }
+
+    cout << "Corpus: " << C.positions.size() << " positions, " << C.moves.size() << " moves\n";
+    cout << "Warmup: " << warmup << " passes, samples: " << samples << " passes\n\n";
+
+    char line[256];
+    snprintf(line, sizeof(line), "%-24s %10s %10s %10s %10s %10s\n", "kernel (ns/op)", "min", "p50", "p90", "p99", "mean");
+    cout << line;
+    for (auto& r : results) {
+        snprintf(line, sizeof(line), "%-24s %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+                 r.name.c_str(), r.min, r.p50, r.p90, r.p99, r.mean);
+        cout << line;
+    }
+
+    cout << "\n";
+    if (!counters.available())
+        cout << perf_report(counters);
+    for (auto& r : results)
+        if (counters.available())
+            cout << r.name << ": " << perf_to_str(r.perf, r.ops * samples) << "\n";
+    cout << "\nChecksum: " << sink << "\n";
+    return 0;
+}
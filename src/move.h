@@ -2,43 +2,39 @@
 #define _MOVE_H_
 
 #include "bitboard.h"
-#include <bits/stdint-uintn.h>
+#include <stdint.h>
+#include <string>
 
-typedef uint32_t Move;
+typedef uint16_t Move;
 
 /*
-    Move -> encoded in uint32 (4 bytes)
-    
-    Source square       ->   first byte
-    Destination square  ->   second byte
-    Piece               ->   first 4 bits of 3rd byte
-    Promoted piece      ->   second 4 bits of 3rd byte
-    Flags               ->   first 4 bits of last byte
-        (CAPTURE, CASTLE, ENPASSANT, UNCASTLE)
-    Score               ->   last 4 bits of last byte
-        (used for move ordering)
-    
-                    Binary                    Field             Mask
-
-    0000 0000 0000 0000 0000 0000 1111 1111   src               0xff
-    0000 0000 0000 0000 1111 1111 0000 0000   dest              0xff00
-    0000 0000 0000 1111 0000 0000 0000 0000   piece             0xf0000
-    0000 0000 1111 0000 0000 0000 0000 0000   promoted          0xf00000
-    0000 0001 0000 0000 0000 0000 0000 0000   capture flag      0x1000000
-    0000 0010 0000 0000 0000 0000 0000 0000   castle flag       0x2000000
-    0000 0100 0000 0000 0000 0000 0000 0000   enpassant flag    0x4000000
-    0000 1000 0000 0000 0000 0000 0000 0000   uncastle flag     0x8000000
-    1111 0000 0000 0000 0000 0000 0000 0000   score             0xf0000000
+    Move -> encoded in uint16 (2 bytes)
 
+    Source square       ->   first 6 bits
+    Destination square  ->   next 6 bits
+    Promoted piece      ->   next 2 bits (BISHOP, KNIGHT, ROOK, QUEEN)
+    Special flag        ->   last 2 bits
+        (NORMAL, PROMOTION, ENPASSANT, CASTLE)
+
+    The moving and captured pieces are not stored, they are read from the
+    board's piece_on mailbox. Scores used for move ordering are kept in a
+    separate array next to the moves (see move_array).
+
+            Binary          Field             Mask
+
+    0000 0000 0011 1111     src               0x3f
+    0000 1111 1100 0000     dest              0xfc0
+    0011 0000 0000 0000     promoted          0x3000
+    1100 0000 0000 0000     special flag      0xc000
+
+    Move 0 (h1h1) is never a valid move and is used as "no move".
 */
 
 enum {
-    // Flag overlap: CAPTURE can also be ENPASSANT or UNCASTLE
-    NO_FLAGS = 0,       // Quiet move
-    CAPTURE = 1,        // Capture move, remove opponent piece
-    CASTLE = 2,         // Castleing move, also move relevant rook
-    ENPASSANT = 4,      // En Passant move, set or capture en passant square
-    UNCASTLE = 8        // Just remove castle permisions
+    NORMAL = 0,         // Quiet move or capture
+    PROMOTION = 1,      // Pawn promotion, promoted piece is set
+    ENPASSANT = 2,      // En Passant capture, remove pawn behind dest
+    CASTLE = 3          // Castleing move, also move relevant rook
 };
 
 // table for looking up value of capture
@@ -47,87 +43,106 @@ constexpr int capture_score_table[6][5] = {
     {
         4, // pawn
         5, // bishop
-        6, // knight 
-        7, // rook 
-        8, // queen 
+        6, // knight
+        7, // rook
+        8, // queen
     },
     // bishop takes
     {
         3, // pawn
         4, // bishop
-        5, // knight 
-        6, // rook 
-        7, // queen 
+        5, // knight
+        6, // rook
+        7, // queen
     },
     // knight takes
     {
         2, // pawn
         3, // bishop
-        4, // knight 
-        5, // rook 
-        6, // queen 
+        4, // knight
+        5, // rook
+        6, // queen
     },
     // rook takes
     {
         1, // pawn
         2, // bishop
-        3, // knight 
-        4, // rook 
-        5, // queen 
+        3, // knight
+        4, // rook
+        5, // queen
     },
     // queen takes
     {
         0, // pawn
         1, // bishop
-        2, // knight 
-        3, // rook 
-        4, // queen 
+        2, // knight
+        3, // rook
+        4, // queen
     },
     // king takes
     {
         0, // pawn
         0, // bishop
-        0, // knight 
-        1, // rook 
-        2, // queen 
+        0, // knight
+        1, // rook
+        2, // queen
     }
 };
 
-inline Move encode(square src, square dest, piece p, piece promoted, uint8_t flags) {
-    return 0u | src | (dest << 8) | (p << 16) | (promoted << 20) | (flags << 24);
+// move ordering scores, quiet moves in between are ordered by history
+enum : int16_t {
+    TT_MOVE_SCORE = 30000,          // best move stored in transposition table
+    PROMOTION_SCORE = 10000,        // queen promotions
+    CHECK_SCORE = 9000,             // quiet checks and castles
+    KILLER_SCORE = 8000,            // quiet moves that caused cutoffs at the same ply
+    HISTORY_MAX = 4000,             // history scores are kept in [0, HISTORY_MAX]
+    UNDERPROMOTION_SCORE = -10000   // knight, rook and bishop promotions
+};
+
+inline Move encode(square src, square dest) {
+    return src | (dest << 6);
+}
+
+inline Move encode(square src, square dest, uint8_t special) {
+    return src | (dest << 6) | (special << 14);
 }
 
-inline Move encode(square src, square dest, piece p, piece promoted, uint8_t flags, int score) {
-    return 0u |
-        src | (dest << 8) | (p << 16) | (promoted << 20) | (flags << 24) | (score << 28);
+// promoted is BISHOP, KNIGHT, ROOK or QUEEN
+inline Move encode(square src, square dest, uint8_t special, uint8_t promoted) {
+    return src | (dest << 6) | ((promoted - 1) << 12) | (special << 14);
 }
 
 inline square get_src(Move m) {
-    return m & 0xff;
+    return m & 0x3f;
 }
 
 inline square get_dest(Move m) {
-    return (m & 0xff00) >> 8;
+    return (m & 0xfc0) >> 6;
 }
 
-inline piece get_piece(Move m) {
-    return (m & 0xf0000) >> 16;
+// only meaningful for PROMOTION moves
+inline uint8_t get_promoted(Move m) {
+    return ((m & 0x3000) >> 12) + 1;
 }
 
-inline piece get_promoted(Move m) {
-    return (m & 0xf00000) >> 20;
+inline uint8_t get_special(Move m) {
+    return (m & 0xc000) >> 14;
 }
 
-inline uint8_t get_flags(Move m) {
-    return (m & 0xf000000) >> 24;
-}
+// coordinate notation used by xboard and uci, e.g. e2e4 or e7e8q
+inline std::string move_to_str(Move m) {
+    square from = get_src(m);
+    square to = get_dest(m);
 
-inline uint8_t get_score(Move m) {
-    return (m & 0xf0000000) >> 28;
-}
+    std::string str = {
+        (char)(7 - (from % 8) + 'a'), (char)(from / 8 + '1'),
+        (char)(7 - (to % 8) + 'a'), (char)(to / 8 + '1')
+    };
 
-inline bool compare_scores(Move x, Move y) {
-    return get_score(x) > get_score(y);
+    // indexed by piece, PAWN .. KING
+    if (get_special(m) == PROMOTION)
+        str += "pbnrqk"[get_promoted(m)];
+    return str;
 }
 
 #endif
@@ -3,10 +3,8 @@
 #include "boardstate.h"
 #include "magics.h"
 #include "move.h"
-#include "algorithm"
 
 typedef bitboard (*bitboard_func) (const bitboard b);
-typedef int (*square_func) (const square to);
 
 ///////////////////////////////////////////////////////////
 //                         Pawns                         //
@@ -345,20 +343,29 @@ void init_move_tables() {
 //           @ <= Performance Critical => @              //
 ///////////////////////////////////////////////////////////
 
-const square_func pawn_promotion[] = {
-    [] (const square to) {return QUEEN * (to >= 56);},
-    [] (const square to) {return QUEEN * (to <= 7);}
-};
+// per-color helpers, Us is known at compile time so these fold to constants
+// pawn move offsets (to - from) and promotion rank
+template<color Us> constexpr int pawn_push_offset = Us == WHITE ? 8 : -8;
+template<color Us> constexpr int pawn_west_offset = Us == WHITE ? 9 : -7;
+template<color Us> constexpr int pawn_east_offset = Us == WHITE ? 7 : -9;
+template<color Us> constexpr bitboard promotion_rank =
+    Us == WHITE ? 0xff00000000000000ull : 0xffull;
+
+// set-wise pawn shifts
+template<color Us>
+inline bitboard pawn_single_pushes(const bitboard pawns) {
+    return Us == WHITE ? get_white_pawn_single_pushes(pawns) : get_black_pawn_single_pushes(pawns);
+}
 
-const square_func pawn_push[] = {
-    [] (const square to) {return to + 8;},
-    [] (const square to) {return to - 8;}
-};
+template<color Us>
+inline bitboard pawn_west_attacks(const bitboard pawns) {
+    return Us == WHITE ? northwestShiftOne(pawns) : southwestShiftOne(pawns);
+}
 
-square_func is_starting_rook_poz[] = {
-    [] (const square poz) {return static_cast<int>(poz == a1 || poz == h1);},
-    [] (const square poz) {return static_cast<int>(poz == a8 || poz == h8);}
-};
+template<color Us>
+inline bitboard pawn_east_attacks(const bitboard pawns) {
+    return Us == WHITE ? northeastShiftOne(pawns) : southeastShiftOne(pawns);
+}
 
 constexpr bitboard pawn_double_push_mask[] = {
     0xff000000ull,
@@ -389,15 +396,110 @@ constexpr bitboard queen_side_castle_blocking[] = {
     0x7000000000000000ull
 };
 
+template<color Us>
 inline int king_check(const bitboard attacks, const Boardstate& B) {
-    return (attacks & B.pieces[1 - B.to_move][KING]) != 0;
+    return (attacks & B.pieces[1 - Us][KING]) != 0;
 }
 
 ///////////////////////////////////////////////////////////
 //           @ <= Performance Critical => @              //
 ///////////////////////////////////////////////////////////
 
+// pawns are generated set-wise: all pawns are shifted at once and the
+// source square is recovered from the target square and the shift offset
+template<int offset, int T>
+inline void push_pawn_moves(bitboard targets, move_array<T>& moves, int16_t score) {
+    while (targets) {
+        square to = get_and_clear_lsb(targets);
+        moves.push(encode(to - offset, to), score);
+    }
+}
+
+template<int offset, int T>
+inline void push_pawn_promotions(bitboard targets, move_array<T>& moves,
+                                 piece promoted, int16_t score) {
+    while (targets) {
+        square to = get_and_clear_lsb(targets);
+        moves.push(encode(to - offset, to, PROMOTION, promoted), score);
+    }
+}
+
+template<color Us, int T>
+inline void generate_pawn_captures(const Boardstate& B, move_array<T>& moves) {
+    constexpr color Them = 1 - Us;
+    const bitboard pawns = B.pieces[Us][PAWN];
+
+    // generate en passant captures
+    if (B.enpassant != no_sq) {
+        bitboard attackers = pawn_attack_table[Them][B.enpassant] & pawns;
+        while (attackers) {
+            square from = get_and_clear_lsb(attackers);
+            moves.push(encode(from, B.enpassant, ENPASSANT), capture_score_table[PAWN][PAWN]);
+        }
+    }
+
+    // generate other captures
+    const bitboard west = pawn_west_attacks<Us>(pawns);
+    const bitboard east = pawn_east_attacks<Us>(pawns);
+
+    for (piece p = PAWN; p < KING; p++) {
+        const bitboard targets = B.pieces[Them][p];
+        const int16_t score = capture_score_table[PAWN][p];
+
+        push_pawn_moves<pawn_west_offset<Us>>(west & targets & ~promotion_rank<Us>, moves, score);
+        push_pawn_moves<pawn_east_offset<Us>>(east & targets & ~promotion_rank<Us>, moves, score);
+        push_pawn_promotions<pawn_west_offset<Us>>(west & targets & promotion_rank<Us>,
+                                                   moves, QUEEN, score + PROMOTION_SCORE);
+        push_pawn_promotions<pawn_east_offset<Us>>(east & targets & promotion_rank<Us>,
+                                                   moves, QUEEN, score + PROMOTION_SCORE);
+    }
+}
+
+template<color Us, int T>
+inline void generate_pawn_pushes(const Boardstate& B, move_array<T>& moves) {
+    const bitboard empty = ~B.board();
+
+    const bitboard single = pawn_single_pushes<Us>(B.pieces[Us][PAWN]) & empty;
+    const bitboard twice = pawn_single_pushes<Us>(single) & empty & pawn_double_push_mask[Us];
+
+    // generate single pushes and promotions
+    push_pawn_moves<pawn_push_offset<Us>>(single & ~promotion_rank<Us>, moves, 0);
+    push_pawn_promotions<pawn_push_offset<Us>>(single & promotion_rank<Us>, moves,
+                                               QUEEN, PROMOTION_SCORE);
+
+    // generate double pushes, make_move sets the en passant square
+    push_pawn_moves<2 * pawn_push_offset<Us>>(twice, moves, 0);
+}
+
+// knight, rook and bishop promotions are rarely best, so these are only
+// generated by generate_all_moves, with the lowest quiet move score
+template<color Us, int T>
+inline void generate_pawn_underpromotions(const Boardstate& B, move_array<T>& moves) {
+    constexpr color Them = 1 - Us;
+    const bitboard pawns = B.pieces[Us][PAWN] & pawn_single_pushes<Them>(promotion_rank<Us>);
+
+    if (!pawns)
+        return;
+
+    const bitboard targets = B.occupancies[Them] & ~B.pieces[Them][KING];
+    const bitboard pushes = pawn_single_pushes<Us>(pawns) & ~B.board();
+    const bitboard west = pawn_west_attacks<Us>(pawns) & targets;
+    const bitboard east = pawn_east_attacks<Us>(pawns) & targets;
+
+    for (piece p : {KNIGHT, ROOK, BISHOP}) {
+        push_pawn_promotions<pawn_push_offset<Us>>(pushes, moves, p, UNDERPROMOTION_SCORE);
+        push_pawn_promotions<pawn_west_offset<Us>>(west, moves, p, UNDERPROMOTION_SCORE);
+        push_pawn_promotions<pawn_east_offset<Us>>(east, moves, p, UNDERPROMOTION_SCORE);
+    }
+}
+
+template<color Us>
 void generate_all_moves(const Boardstate& B, move_list& moves) {
+    constexpr color Them = 1 - Us;
+
+    // capturable pieces, captured piece type is looked up in the mailbox
+    const bitboard enemies = B.occupancies[Them] & ~B.pieces[Them][KING];
+
     // push all possible pseudo-legal moves in moves list
 
     bitboard pieces;
@@ -408,215 +510,170 @@ void generate_all_moves(const Boardstate& B, move_list& moves) {
     ////////////////////////
     //        pawns       //
     ////////////////////////
-    pieces = B.pieces[B.to_move][PAWN];
-
-    while (pieces) {
-        from = get_and_clear_lsb(pieces);
-
-        // generate pawn captures
-        attacks = pawn_attack_table[B.to_move][from];
-
-        // check for enpassant capture
-        if (attacks & (1ull << B.enpassant))
-            moves.captures.push(encode(from, B.enpassant, PAWN, PAWN, CAPTURE | ENPASSANT));
-
-        // check for other captures
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.captures.push(encode(from, to, PAWN, pawn_promotion[B.to_move](to), CAPTURE, capture_score_table[PAWN][p]));
-            }
-        }
-
-        // generate pawn single pushes
-        to = pawn_push[B.to_move](from);
-
-        if (1ull << to & ~B.board) {
-            moves.quiet.push(encode(from, to, PAWN, pawn_promotion[B.to_move](to), NO_FLAGS));
-
-            // generate pawn double pushes
-            to = pawn_push[B.to_move](to);
-
-            if (1ull << to & ~B.board & pawn_double_push_mask[B.to_move]) {
-                // this ugly
-                bool enpas = pawn_attack_table[B.to_move][pawn_push[1 - B.to_move](to)] & 
-                             B.occupancies[1 - B.to_move];
-                moves.quiet.push(encode(from, to, PAWN, PAWN, ENPASSANT * enpas));
-            }
-        }
-    }
+    generate_pawn_captures<Us>(B, moves.captures);
+    generate_pawn_pushes<Us>(B, moves.quiet);
 
     ////////////////////////
     //       knights      //
     ////////////////////////
-    pieces = B.pieces[B.to_move][KNIGHT];
+    pieces = B.pieces[Us][KNIGHT];
 
     while (pieces) {
         from = get_and_clear_lsb(pieces);
  
         // generate knight captures
         attacks = knight_attack_table[from];
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.captures.push(encode(from, to, KNIGHT, KNIGHT, CAPTURE, capture_score_table[KNIGHT][p]));
-            }
+        captures = attacks & enemies;
+        while (captures) {
+            to = get_and_clear_lsb(captures);
+            moves.captures.push(encode(from, to), capture_score_table[KNIGHT][B.piece_on[to]]);
         }
  
         // generate knight attacks
-        attacks = knight_attack_table[from] & ~B.board;
+        attacks = knight_attack_table[from] & ~B.board();
 
         while (attacks) {
             to = get_and_clear_lsb(attacks);
-            moves.quiet.push(encode(from, to, KNIGHT, KNIGHT, NO_FLAGS,
-                                    king_check(knight_attack_table[to], B)));
+            moves.quiet.push(encode(from, to),
+                                    CHECK_SCORE * king_check<Us>(knight_attack_table[to], B));
         }
     }
 
     ////////////////////////
     //        kings       //
     ////////////////////////
-    pieces = B.pieces[B.to_move][KING];
+    pieces = B.pieces[Us][KING];
 
     from = lsb(pieces);
 
-    int uncastle = UNCASTLE * (from == king_start_poz_square[B.to_move]);
-
     // generate castles
-    if (from == king_start_poz_square[B.to_move]) {
+    if (from == king_start_poz_square[Us]) {
         // Castling moves:	e1g1, e1c1, e8g8, e8c8
       
         // king side castle
-        if (!B.flags.test(2 * B.to_move + 1) && // no castle flag
-            !(B.board & king_side_castle_blocking[B.to_move]) && // no blocking pieces
-            B.pieces[B.to_move][ROOK] & rook_start_king_side_mask[B.to_move] && // rook poz
-            !is_attacked(B, from) &&   // king is not in check
-            !is_attacked(B, from - 1)) // moving square is not attacked
+        if (B.flags.test(2 * Us + 1) && // castle right kept
+            !(B.board() & king_side_castle_blocking[Us]) && // no blocking pieces
+            B.pieces[Us][ROOK] & rook_start_king_side_mask[Us] && // rook poz
+            !is_attacked<Us>(B, from) &&   // king is not in check
+            !is_attacked<Us>(B, from - 1)) // moving square is not attacked
 
-            moves.quiet.push(encode(from, from - 2, KING, KING, CASTLE, 1));
+            moves.quiet.push(encode(from, from - 2, CASTLE), CHECK_SCORE);
 
         // queen side castle
-        if (!B.flags.test(2 * B.to_move) && // no castle flag
-            !(B.board & queen_side_castle_blocking[B.to_move]) && // no blocking pieces
-            B.pieces[B.to_move][ROOK] & rook_start_queen_side_mask[B.to_move] && // rook poz
-            !is_attacked(B, from) &&   // king is not in check
-            !is_attacked(B, from + 1)) // moving square is not attacked
+        if (B.flags.test(2 * Us) && // castle right kept
+            !(B.board() & queen_side_castle_blocking[Us]) && // no blocking pieces
+            B.pieces[Us][ROOK] & rook_start_queen_side_mask[Us] && // rook poz
+            !is_attacked<Us>(B, from) &&   // king is not in check
+            !is_attacked<Us>(B, from + 1)) // moving square is not attacked
 
-            moves.quiet.push(encode(from, from + 2, KING, KING, CASTLE, 1));
+            moves.quiet.push(encode(from, from + 2, CASTLE), CHECK_SCORE);
     }
 
     // generate king captures
     attacks = king_attack_table[from];
-    for (piece p = PAWN; p < KING; p++) {
-        captures = attacks & B.pieces[1 - B.to_move][p];
-        while (captures) {
-            to = get_and_clear_lsb(captures);
-            moves.captures.push(encode(from, to, KING, KING, CAPTURE, capture_score_table[KING][p]));
-        }
+    captures = attacks & enemies;
+    while (captures) {
+        to = get_and_clear_lsb(captures);
+        moves.captures.push(encode(from, to), capture_score_table[KING][B.piece_on[to]]);
     }
     
     // generate king attacks
-    attacks = king_attack_table[from] & ~B.board;
+    attacks = king_attack_table[from] & ~B.board();
 
     while (attacks) {
         to = get_and_clear_lsb(attacks);
-        moves.quiet.push(encode(from, to, KING, KING, uncastle));
+        moves.quiet.push(encode(from, to));
     }
 
     ////////////////////////
     //       bishops      //
     ////////////////////////
-    pieces = B.pieces[B.to_move][BISHOP];
+    pieces = B.pieces[Us][BISHOP];
 
     while (pieces) {
         from = get_and_clear_lsb(pieces);
 
         // generate bishop captures
-        attacks = get_bishop_attacks(from, B.board);
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.captures.push(encode(from, to, BISHOP, BISHOP, CAPTURE, capture_score_table[KING][p]));
-            }
+        attacks = get_bishop_attacks(from, B.board());
+        captures = attacks & enemies;
+        while (captures) {
+            to = get_and_clear_lsb(captures);
+            moves.captures.push(encode(from, to), capture_score_table[BISHOP][B.piece_on[to]]);
         }
 
         // generate bishop attacks
-        attacks &= ~B.board;
+        attacks &= ~B.board();
         while (attacks) {
             to = get_and_clear_lsb(attacks);
-            moves.quiet.push(encode(from, to, BISHOP, BISHOP, NO_FLAGS,
-                                    king_check(get_bishop_attacks(to, B.board), B)));
+            moves.quiet.push(encode(from, to),
+                                    CHECK_SCORE * king_check<Us>(get_bishop_attacks(to, B.board()), B));
         }
     }
 
     ////////////////////////
     //       rooks        //
     ////////////////////////
-    pieces = B.pieces[B.to_move][ROOK];
+    pieces = B.pieces[Us][ROOK];
 
     while (pieces) {
         from = get_and_clear_lsb(pieces);
 
-        int uncastle = UNCASTLE * is_starting_rook_poz[B.to_move](from);
-
         // generate rook captures
-        attacks = get_rook_attacks(from, B.board);
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.captures.push(encode(from, to, ROOK, ROOK, CAPTURE, capture_score_table[KING][p]));
-            }
+        attacks = get_rook_attacks(from, B.board());
+        captures = attacks & enemies;
+        while (captures) {
+            to = get_and_clear_lsb(captures);
+            moves.captures.push(encode(from, to), capture_score_table[ROOK][B.piece_on[to]]);
         }
 
         // generate rook attacks
-        attacks &= ~B.board;
+        attacks &= ~B.board();
         while (attacks) {
             to = get_and_clear_lsb(attacks);
-            moves.quiet.push(encode(from, to, ROOK, ROOK, uncastle,
-                                    king_check(get_rook_attacks(to, B.board), B)));
+            moves.quiet.push(encode(from, to),
+                                    CHECK_SCORE * king_check<Us>(get_rook_attacks(to, B.board()), B));
         }
     }
     
     ////////////////////////
     //       queens       //
     ////////////////////////
-    pieces = B.pieces[B.to_move][QUEEN];
+    pieces = B.pieces[Us][QUEEN];
 
     while (pieces) {
         from = get_and_clear_lsb(pieces);
 
         // generate queen captures
-        attacks = get_queen_attacks(from, B.board);
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.captures.push(encode(from, to, QUEEN, QUEEN, CAPTURE, capture_score_table[KING][p]));
-            }
+        attacks = get_queen_attacks(from, B.board());
+        captures = attacks & enemies;
+        while (captures) {
+            to = get_and_clear_lsb(captures);
+            moves.captures.push(encode(from, to), capture_score_table[QUEEN][B.piece_on[to]]);
         }
 
         // generate queen attacks
-        attacks &= ~B.board;
+        attacks &= ~B.board();
         while (attacks) {
             to = get_and_clear_lsb(attacks);
-            moves.quiet.push(encode(from, to, QUEEN, QUEEN, NO_FLAGS, 
-                                    king_check(get_queen_attacks(to, B.board), B)));
+            moves.quiet.push(encode(from, to),
+                                    CHECK_SCORE * king_check<Us>(get_queen_attacks(to, B.board()), B));
         }
     }
     
-    std::sort(moves.captures.begin(), moves.captures.end(), compare_scores);
-    std::sort(moves.quiet.begin(), moves.quiet.end(), compare_scores);
+    generate_pawn_underpromotions<Us>(B, moves.quiet);
 }
 
 ///////////////////////////////////////////////////////////
 //           @ <= Performance Critical => @              //
 ///////////////////////////////////////////////////////////
 
-void generate_capture_moves(const Boardstate& B, move_array<64>& moves) {
+template<color Us>
+void generate_capture_moves(const Boardstate& B, move_array<MAX_MOVES>& moves) {
+    constexpr color Them = 1 - Us;
+
+    // capturable pieces, captured piece type is looked up in the mailbox
+    const bitboard enemies = B.occupancies[Them] & ~B.pieces[Them][KING];
+
     bitboard pieces;
     square to;
     square from;
@@ -625,142 +682,111 @@ void generate_capture_moves(const Boardstate& B, move_array<64>& moves) {
     ////////////////////////
     //        pawns       //
     ////////////////////////
-    pieces = B.pieces[B.to_move][PAWN];
-
-    while (pieces) {
-        from = get_and_clear_lsb(pieces);
-
-        // generate pawn captures
-        attacks = pawn_attack_table[B.to_move][from];
-
-        // check for enpassant capture
-        if (attacks & (1ull << B.enpassant))
-            moves.push(encode(from, B.enpassant, PAWN, PAWN, CAPTURE | ENPASSANT));
-
-        // check for other captures
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.push(encode(from, to, PAWN, pawn_promotion[B.to_move](to), CAPTURE, capture_score_table[PAWN][p]));
-            }
-        }
-    }
+    generate_pawn_captures<Us>(B, moves);
 
     ////////////////////////
     //       knights      //
     ////////////////////////
-    pieces = B.pieces[B.to_move][KNIGHT];
+    pieces = B.pieces[Us][KNIGHT];
 
     while (pieces) {
         from = get_and_clear_lsb(pieces);
  
         // generate knight captures
         attacks = knight_attack_table[from];
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.push(encode(from, to, KNIGHT, KNIGHT, CAPTURE, capture_score_table[KNIGHT][p]));
-            }
+        captures = attacks & enemies;
+        while (captures) {
+            to = get_and_clear_lsb(captures);
+            moves.push(encode(from, to), capture_score_table[KNIGHT][B.piece_on[to]]);
         }
     }
 
     ////////////////////////
     //        kings       //
     ////////////////////////
-    pieces = B.pieces[B.to_move][KING];
+    pieces = B.pieces[Us][KING];
 
     from = lsb(pieces);
 
     // generate king captures
     attacks = king_attack_table[from];
-    for (piece p = PAWN; p < KING; p++) {
-        captures = attacks & B.pieces[1 - B.to_move][p];
-        while (captures) {
-            to = get_and_clear_lsb(captures);
-            moves.push(encode(from, to, KING, KING, CAPTURE, capture_score_table[KING][p]));
-        }
+    captures = attacks & enemies;
+    while (captures) {
+        to = get_and_clear_lsb(captures);
+        moves.push(encode(from, to), capture_score_table[KING][B.piece_on[to]]);
     }
     
     ////////////////////////
     //       bishops      //
     ////////////////////////
-    pieces = B.pieces[B.to_move][BISHOP];
+    pieces = B.pieces[Us][BISHOP];
 
     while (pieces) {
         from = get_and_clear_lsb(pieces);
 
         // generate bishop captures
-        attacks = get_bishop_attacks(from, B.board);
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.push(encode(from, to, BISHOP, BISHOP, CAPTURE, capture_score_table[KING][p]));
-            }
+        attacks = get_bishop_attacks(from, B.board());
+        captures = attacks & enemies;
+        while (captures) {
+            to = get_and_clear_lsb(captures);
+            moves.push(encode(from, to), capture_score_table[BISHOP][B.piece_on[to]]);
         }
     }
 
     ////////////////////////
     //       rooks        //
     ////////////////////////
-    pieces = B.pieces[B.to_move][ROOK];
+    pieces = B.pieces[Us][ROOK];
 
     while (pieces) {
         from = get_and_clear_lsb(pieces);
 
         // generate rook captures
-        attacks = get_rook_attacks(from, B.board);
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.push(encode(from, to, ROOK, ROOK, CAPTURE, capture_score_table[KING][p]));
-            }
+        attacks = get_rook_attacks(from, B.board());
+        captures = attacks & enemies;
+        while (captures) {
+            to = get_and_clear_lsb(captures);
+            moves.push(encode(from, to), capture_score_table[ROOK][B.piece_on[to]]);
         }
     }
     
     ////////////////////////
     //       queens       //
     ////////////////////////
-    pieces = B.pieces[B.to_move][QUEEN];
+    pieces = B.pieces[Us][QUEEN];
 
     while (pieces) {
         from = get_and_clear_lsb(pieces);
 
         // generate queen captures
-        attacks = get_queen_attacks(from, B.board);
-        for (piece p = PAWN; p < KING; p++) {
-            captures = attacks & B.pieces[1 - B.to_move][p];
-            while (captures) {
-                to = get_and_clear_lsb(captures);
-                moves.push(encode(from, to, QUEEN, QUEEN, CAPTURE, capture_score_table[KING][p]));
-            }
+        attacks = get_queen_attacks(from, B.board());
+        captures = attacks & enemies;
+        while (captures) {
+            to = get_and_clear_lsb(captures);
+            moves.push(encode(from, to), capture_score_table[QUEEN][B.piece_on[to]]);
         }
     }
-    
-    std::sort(moves.begin(), moves.end(), compare_scores);
 }
 
 ///////////////////////////////////////////////////////////
 //           @ <= Performance Critical => @              //
 ///////////////////////////////////////////////////////////
 
+template<color Us>
 bool is_attacked(const Boardstate& B, const square poz) {
     // check is square is currently under attack
-    int side = 1 - B.to_move;
+    constexpr color side = 1 - Us;
 
     bitboard attacks = 0;
 
-    attacks |= pawn_attack_table[B.to_move][poz] & B.pieces[side][PAWN];
+    attacks |= pawn_attack_table[Us][poz] & B.pieces[side][PAWN];
     attacks |= knight_attack_table[poz] & B.pieces[side][KNIGHT];
     attacks |= king_attack_table[poz] & B.pieces[side][KING];
     
-    bitboard bishops = get_bishop_attacks(poz, B.board);
+    bitboard bishops = get_bishop_attacks(poz, B.board());
     attacks |= bishops & B.pieces[side][BISHOP];
 
-    bitboard rooks = get_rook_attacks(poz, B.board);
+    bitboard rooks = get_rook_attacks(poz, B.board());
     attacks |= rooks & B.pieces[side][ROOK];
 
     attacks |= (bishops | rooks) & B.pieces[side][QUEEN];
@@ -768,6 +794,32 @@ bool is_attacked(const Boardstate& B, const square poz) {
     return attacks;
 }
 
+// runtime dispatch on side to move, for callers that don't know it statically
+void generate_all_moves(const Boardstate& B, move_list& moves) {
+    if (B.to_move == WHITE)
+        generate_all_moves<WHITE>(B, moves);
+    else
+        generate_all_moves<BLACK>(B, moves);
+}
+
+void generate_capture_moves(const Boardstate& B, move_array<MAX_MOVES>& moves) {
+    if (B.to_move == WHITE)
+        generate_capture_moves<WHITE>(B, moves);
+    else
+        generate_capture_moves<BLACK>(B, moves);
+}
+
+bool is_attacked(const Boardstate& B, const square poz) {
+    return B.to_move == WHITE ? is_attacked<WHITE>(B, poz) : is_attacked<BLACK>(B, poz);
+}
+
+template void generate_all_moves<WHITE>(const Boardstate& B, move_list& moves);
+template void generate_all_moves<BLACK>(const Boardstate& B, move_list& moves);
+template void generate_capture_moves<WHITE>(const Boardstate& B, move_array<MAX_MOVES>& moves);
+template void generate_capture_moves<BLACK>(const Boardstate& B, move_array<MAX_MOVES>& moves);
+template bool is_attacked<WHITE>(const Boardstate& B, const square poz);
+template bool is_attacked<BLACK>(const Boardstate& B, const square poz);
+
 ///////////////////////////////////////////////////////////
 
 // helper function for slinding pieces pre-calculated tables
@@ -784,6 +836,56 @@ bitboard gen_occupancy(const int index, bitboard attacks) {
     return occupancy;
 }
 
+void generate_legal_moves(const Boardstate& B, move_list& moves) {
+    int first[2] = {moves.captures.count, moves.quiet.count};
+    generate_all_moves(B, moves);
+
+    // compacts the new moves in place, order and scores are kept
+    int k = 0;
+    for (auto list : {&moves.captures, &moves.quiet}) {
+        int count = first[k++];
+        for (int i = count; i < list->count; i++) {
+            Boardstate C = B;
+            if (C.make_move(list->arr[i])) {
+                list->arr[count] = list->arr[i];
+                list->scores[count++] = list->scores[i];
+            }
+        }
+        list->count = count;
+    }
+}
+
+bool has_legal_move(const Boardstate& B) {
+    move_list moves;
+    generate_all_moves(B, moves);
+    for (auto list : {&moves.captures, &moves.quiet})
+        for (auto m : *list) {
+            Boardstate C = B;
+            if (C.make_move(m))
+                return true;
+        }
+    return false;
+}
+
+// counts leaf nodes of the legal move tree, for verifying move generation
+uint64_t perft(const Boardstate& B, int depth) {
+    move_list moves;
+    generate_all_moves(B, moves);
+
+    uint64_t nodes = 0;
+    for (auto m : moves.captures) {
+        Boardstate C = B;
+        if (C.make_move(m))
+            nodes += depth > 1 ? perft(C, depth - 1) : 1;
+    }
+    for (auto m : moves.quiet) {
+        Boardstate C = B;
+        if (C.make_move(m))
+            nodes += depth > 1 ? perft(C, depth - 1) : 1;
+    }
+    return nodes;
+}
+
 // for debugging
 bitboard test_attack_tables(piece p, color c, square poz, bitboard occupancy) {
     switch (p) {
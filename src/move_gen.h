@@ -4,21 +4,47 @@
 #include "bitboard.h"
 #include "move.h"
 #include "boardstate.h"
+#include <cassert>
+#include <utility>
+
+// at most 218 legal moves exist in any position, pseudo legal
+// generation can add a few moves that leave the king in check
+#define MAX_MOVES 256
 
 template<int T>
 struct move_array {
     std::array<Move, T> arr;
-    uint8_t count;
+    std::array<int16_t, T> scores;
+    uint16_t count;
 
     // base constructor
     move_array(): count(0) {};
 
-    // pushes a move to the list
-    inline void push(Move m) {
+    // pushes a move to the list, with its ordering score
+    inline void push(Move m, int16_t score = 0) {
+        assert(count < T && "move_array overflow");
+        scores[count] = score;
         arr[count++] = m;
     }
 
-    // iterators for range for loops
+    inline void clear() {
+        count = 0;
+    }
+
+    // swaps the best scored move in [i, count) to position i and returns it
+    // (lazy selection sort, most nodes cut off after the first few moves)
+    inline Move pick(int i) {
+        int best = i;
+        for (int j = i + 1; j < count; j++)
+            if (scores[j] > scores[best])
+                best = j;
+
+        std::swap(arr[i], arr[best]);
+        std::swap(scores[i], scores[best]);
+        return arr[i];
+    }
+
+    // iterators for range for loops, in generation order
     inline Move* begin() {
         return arr.begin();
     }
@@ -29,15 +55,37 @@ struct move_array {
 };
 
 struct move_list {
-    move_array<128> captures;
-    move_array<128> quiet;
+    move_array<MAX_MOVES> captures;
+    move_array<MAX_MOVES> quiet;
+
+    inline void clear() {
+        captures.clear();
+        quiet.clear();
+    }
 };
 
 void init_move_tables();
+
+// Us is the side to move, all per-color constants are resolved at compile time
+template<color Us> void generate_all_moves(const Boardstate& B, move_list& moves);
+template<color Us> void generate_capture_moves(const Boardstate& B, move_array<MAX_MOVES>& moves);
+template<color Us> bool is_attacked(const Boardstate& B, const square poz);
+
+// dispatch on B.to_move
 void generate_all_moves(const Boardstate& B, move_list& moves);
-void generate_capture_moves(const Boardstate& B, move_array<64>& moves);
+void generate_capture_moves(const Boardstate& B, move_array<MAX_MOVES>& moves);
 bool is_attacked(const Boardstate& B, const square poz);
 
+// like generate_all_moves, without the moves that leave the king in
+// check; slower, for code outside the search
+void generate_legal_moves(const Boardstate& B, move_list& moves);
+
+// false on checkmate or stalemate
+bool has_legal_move(const Boardstate& B);
+
+// number of leaf nodes at depth, 3-check wins are not terminal
+uint64_t perft(const Boardstate& B, int depth);
+
 // for debugging
 bitboard test_attack_tables(piece p, color c, square poz, bitboard occupancy);
 #endif
@@ -0,0 +1,132 @@
+#include "perf_counters.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// (type, config) of every counter, in the order of the enum
+static const std::pair<uint32_t, uint64_t> perf_events[PERF_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+perf_counters::perf_counters() {
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_events[i].first;
+        attr.config = perf_events[i].second;
+        attr.disabled = 1;
+        // user space only, allowed with the default perf_event_paranoid
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+perf_counters::~perf_counters() {
+    for (int fd : fds)
+        if (fd >= 0)
+            close(fd);
+}
+
+void perf_counters::start() {
+    for (int fd : fds)
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+}
+
+void perf_counters::stop() {
+    for (int fd : fds)
+        if (fd >= 0)
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+}
+
+perf_values perf_counters::read() const {
+    perf_values values;
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        // value, time enabled, time running
+        uint64_t data[3];
+        if (fds[i] < 0 || ::read(fds[i], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+            continue;
+
+        values.count[i] = data[2] < data[1] ? (uint64_t)((double)data[0] * data[1] / data[2]) : data[0];
+        values.valid[i] = true;
+    }
+    return values;
+}
+
+#else
+
+perf_counters::perf_counters() {
+    for (int i = 0; i < PERF_COUNTERS; i++)
+        fds[i] = -1;
+}
+
+perf_counters::~perf_counters() {}
+void perf_counters::start() {}
+void perf_counters::stop() {}
+
+perf_values perf_counters::read() const {
+    return perf_values();
+}
+
+#endif
+
+bool perf_counters::available() const {
+    for (int fd : fds)
+        if (fd >= 0)
+            return true;
+    return false;
+}
+
+std::string perf_to_str(const perf_values& values, uint64_t ops) {
+    static const char* names[PERF_COUNTERS] = {
+        "cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"
+    };
+
+    std::string str;
+    char buf[64];
+    for (int i = 0; i < PERF_COUNTERS; i++) {
+        if (!values.valid[i])
+            continue;
+        snprintf(buf, sizeof(buf), ops > 1 ? "%s %.2f " : "%s %.0f ", names[i],
+                 (double)values.count[i] / ops);
+        str += buf;
+
+        if (i == PERF_INSTRUCTIONS && values.valid[PERF_CYCLES] && values.count[PERF_CYCLES]) {
+            snprintf(buf, sizeof(buf), "IPC %.2f ",
+                     (double)values.count[PERF_INSTRUCTIONS] / values.count[PERF_CYCLES]);
+            str += buf;
+        }
+    }
+
+    if (!str.empty())
+        str.pop_back();
+    return str;
+}
+
+std::string perf_report(const perf_counters& counters, uint64_t ops, const std::string& op_name) {
+    if (!counters.available())
+        return "Perf counters: unavailable (no hardware counters or no permission, see /proc/sys/kernel/perf_event_paranoid)\n";
+
+    perf_values values = counters.read();
+    std::string report = "Perf counters: " + perf_to_str(values) + "\n";
+    if (ops != 0)
+        report += "Per " + op_name + ": " + perf_to_str(values, ops) + "\n";
+    return report;
+}
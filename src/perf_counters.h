@@ -0,0 +1,54 @@
+#ifndef _PERF_COUNTERS_H_
+#define _PERF_COUNTERS_H_
+#include <stdint.h>
+#include <string>
+
+// hardware counters of the calling thread (user space only) through
+// perf_event_open, counters the kernel refuses (no permission, virtual
+// machines, other platforms) are simply left out
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_COUNTERS
+};
+
+struct perf_values {
+    uint64_t count[PERF_COUNTERS] = {};
+    bool valid[PERF_COUNTERS] = {};
+};
+
+class perf_counters
+{
+  public:
+    perf_counters();
+    ~perf_counters();
+    perf_counters(const perf_counters&) = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    // false if no counter could be opened
+    bool available() const;
+
+    // resets and starts counting, stop() freezes the values
+    void start();
+    void stop();
+
+    // counts between start and stop, scaled if the kernel multiplexed them
+    perf_values read() const;
+
+  private:
+    int fds[PERF_COUNTERS];
+};
+
+// e.g. "cycles 1200 instructions 3000 IPC 2.50 branch-misses 10 ...",
+// every count divided by ops (per operation figures)
+std::string perf_to_str(const perf_values& values, uint64_t ops = 1);
+
+// the counters for a report, with ops also per operation
+// (e.g. per node), or why there are none
+std::string perf_report(const perf_counters& counters, uint64_t ops = 0,
+                        const std::string& op_name = "op");
+
+#endif
@@ -0,0 +1,433 @@
+#include "pgn.h"
+#include "move_gen.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// pages behind the game being read are given back to the kernel every
+// so often, so the resident size stays small on huge files
+#define RELEASE_INTERVAL (64 << 20)
+
+// indexed by piece, PAWN .. KING
+static const char piece_letters[] = "PBNRQK";
+
+static char file_char(square sq) {
+    return 7 - (sq % 8) + 'a';
+}
+
+static char rank_char(square sq) {
+    return sq / 8 + '1';
+}
+
+static bool in_check(const Boardstate& B) {
+    return is_attacked(B, lsb(B.pieces[B.to_move][KING]));
+}
+
+///////////////////////////////////////////////////////////
+//                          SAN                          //
+///////////////////////////////////////////////////////////
+
+std::string move_to_san(const Boardstate& B, Move m) {
+    square src = get_src(m), dest = get_dest(m);
+    piece p = B.piece_on[src];
+    std::string san;
+
+    if (get_special(m) == CASTLE) {
+        san = file_char(dest) == 'g' ? "O-O" : "O-O-O";
+    } else {
+        bool capture = B.piece_on[dest] != NULL_PIECE || get_special(m) == ENPASSANT;
+        if (p == PAWN) {
+            if (capture)
+                san += file_char(src);
+        } else {
+            san += piece_letters[p];
+
+            // other legal moves of the same kind of piece to dest
+            bool ambiguous = false, same_file = false, same_rank = false;
+            move_list moves;
+            generate_all_moves(B, moves);
+            for (auto list : {&moves.captures, &moves.quiet})
+                for (auto n : *list) {
+                    square other = get_src(n);
+                    if (n == m || other == src || get_dest(n) != dest || B.piece_on[other] != p)
+                        continue;
+                    Boardstate C = B;
+                    if (!C.make_move(n))
+                        continue;
+                    ambiguous = true;
+                    same_file |= other % 8 == src % 8;
+                    same_rank |= other / 8 == src / 8;
+                }
+
+            if (ambiguous) {
+                if (!same_file)
+                    san += file_char(src);
+                else if (!same_rank)
+                    san += rank_char(src);
+                else
+                    san += {file_char(src), rank_char(src)};
+            }
+        }
+
+        if (capture)
+            san += 'x';
+        san += {file_char(dest), rank_char(dest)};
+        if (get_special(m) == PROMOTION)
+            san += {'=', piece_letters[get_promoted(m)]};
+    }
+
+    Boardstate C = B;
+    C.make_move(m);
+    if (in_check(C))
+        san += has_legal_move(C) ? '+' : '#';
+    return san;
+}
+
+Move san_to_move(const Boardstate& B, std::string_view san) {
+    while (!san.empty() && std::string_view("+#!?").find(san.back()) != std::string_view::npos)
+        san.remove_suffix(1);
+
+    bool short_castle = san == "O-O" || san == "0-0";
+    bool long_castle = san == "O-O-O" || san == "0-0-0";
+
+    piece p = PAWN;
+    int promoted = NULL_PIECE;
+    int src_file = -1, src_rank = -1;
+    square dest = 0;
+
+    if (!short_castle && !long_castle) {
+        const char* letter = san.empty() ? nullptr : std::strchr(piece_letters + 1, san.front());
+        if (letter && *letter) {
+            p = letter - piece_letters;
+            san.remove_prefix(1);
+        }
+
+        // e8=Q, also e8Q and e8=q
+        if (san.size() > 2) {
+            bool marked = san[san.size() - 2] == '=';
+            const char* promo = std::strchr(piece_letters + 1, marked ? std::toupper(san.back()) : san.back());
+            if (promo && *promo && *promo != 'K') {
+                promoted = promo - piece_letters;
+                san.remove_suffix(marked ? 2 : 1);
+            }
+        }
+
+        if (san.size() < 2)
+            return 0;
+        char f = san[san.size() - 2], r = san.back();
+        if (f < 'a' || f > 'h' || r < '1' || r > '8')
+            return 0;
+        dest = (r - '1') * 8 + 7 - (f - 'a');
+        san.remove_suffix(2);
+
+        for (char c : san) {
+            if (c >= 'a' && c <= 'h')
+                src_file = c - 'a';
+            else if (c >= '1' && c <= '8')
+                src_rank = c - '1';
+            else if (c != 'x' && c != ':' && c != '-')
+                return 0;
+        }
+    }
+
+    move_list moves;
+    generate_all_moves(B, moves);
+
+    Move found = 0;
+    for (auto list : {&moves.captures, &moves.quiet})
+        for (auto m : *list) {
+            square src = get_src(m);
+            if (short_castle || long_castle) {
+                if (get_special(m) != CASTLE || (file_char(get_dest(m)) == 'g') != short_castle)
+                    continue;
+            } else {
+                if (get_dest(m) != dest || B.piece_on[src] != p || get_special(m) == CASTLE)
+                    continue;
+                if ((get_special(m) == PROMOTION ? (int)get_promoted(m) : NULL_PIECE) != promoted)
+                    continue;
+                if ((src_file >= 0 && 7 - src % 8 != src_file) || (src_rank >= 0 && src / 8 != src_rank))
+                    continue;
+            }
+
+            Boardstate C = B;
+            if (!C.make_move(m))
+                continue;
+            if (found)
+                return 0;
+            found = m;
+        }
+    return found;
+}
+
+///////////////////////////////////////////////////////////
+//                        Reader                         //
+///////////////////////////////////////////////////////////
+
+std::string_view pgn_game::tag(std::string_view name) const {
+    for (auto& t : tags)
+        if (t.first == name)
+            return t.second;
+    return {};
+}
+
+PgnReader::PgnReader(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+            data = (const char*)mapped;
+            size = st.st_size;
+        }
+    }
+    close(fd);
+}
+
+PgnReader::~PgnReader() {
+    if (data)
+        munmap((void*)data, size);
+}
+
+bool PgnReader::is_open() const {
+    return data != nullptr;
+}
+
+// whitespace, comments, variations, NAGs and escaped lines
+void PgnReader::skip_space() {
+    while (pos < size) {
+        char c = data[pos];
+        if (std::isspace((unsigned char)c)) {
+            pos++;
+        } else if (c == '{') {
+            const char* end = (const char*)std::memchr(data + pos, '}', size - pos);
+            pos = end ? end - data + 1 : size;
+        } else if (c == ';' || (c == '%' && (pos == 0 || data[pos - 1] == '\n'))) {
+            const char* end = (const char*)std::memchr(data + pos, '\n', size - pos);
+            pos = end ? end - data + 1 : size;
+        } else if (c == '$') {
+            pos++;
+            while (pos < size && std::isdigit((unsigned char)data[pos]))
+                pos++;
+        } else if (c == '(') {
+            int depth = 0;
+            while (pos < size) {
+                c = data[pos++];
+                if (c == '(')
+                    depth++;
+                else if (c == ')' && --depth == 0)
+                    break;
+                else if (c == '{') {
+                    const char* end = (const char*)std::memchr(data + pos, '}', size - pos);
+                    pos = end ? end - data + 1 : size;
+                }
+            }
+        } else if (c == ')' || c == '}') {
+            pos++;      // unbalanced
+        } else {
+            return;
+        }
+    }
+}
+
+// the next movetext token, up to whitespace or the start of a comment,
+// variation or tag
+std::string_view PgnReader::token() {
+    size_t start = pos;
+    while (pos < size && !std::isspace((unsigned char)data[pos]) && !std::strchr("{}();[]$", data[pos]))
+        pos++;
+    return std::string_view(data + start, pos - start);
+}
+
+bool PgnReader::next(pgn_game& game) {
+    game.tags.clear();
+    game.moves.clear();
+    game.result = PGN_UNKNOWN;
+    game.error = false;
+
+    skip_space();
+    if (pos >= size)
+        return false;
+
+    // nothing before the current game is looked at again
+    if (pos - released >= RELEASE_INTERVAL) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        released = pos / page * page;
+        madvise((void*)data, released, MADV_DONTNEED);
+    }
+
+    // [Name "value"], escapes are left in the value
+    while (pos < size && data[pos] == '[') {
+        size_t start = ++pos;
+        while (pos < size && !std::isspace((unsigned char)data[pos]) && data[pos] != '"' && data[pos] != ']')
+            pos++;
+        std::string_view name(data + start, pos - start);
+
+        while (pos < size && data[pos] != '"' && data[pos] != ']')
+            pos++;
+        std::string_view value;
+        if (pos < size && data[pos] == '"') {
+            start = ++pos;
+            while (pos < size && data[pos] != '"' && data[pos] != '\n') {
+                if (data[pos] == '\\' && pos + 1 < size)
+                    pos++;
+                pos++;
+            }
+            value = std::string_view(data + start, pos - start);
+        }
+        while (pos < size && data[pos] != ']' && data[pos] != '\n')
+            pos++;
+        if (pos < size && data[pos] == ']')
+            pos++;
+
+        game.tags.push_back({name, value});
+        skip_space();
+    }
+
+    std::string_view fen = game.tag("FEN");
+    if (fen.empty())
+        game.start.reset();
+    else if (!game.start.set_fen(std::string(fen)))
+        game.error = true;
+
+    Boardstate B = game.start;
+    while (true) {
+        skip_space();
+        // a game without a result ends at the next one's tags
+        if (pos >= size || data[pos] == '[')
+            break;
+
+        std::string_view t = token();
+        if (t.empty()) {
+            pos++;
+            continue;
+        }
+
+        if (t == "1-0" || t == "0-1" || t == "1/2-1/2" || t == "*") {
+            game.result = t == "1-0" ? PGN_WHITE_WINS : t == "0-1" ? PGN_BLACK_WINS : t == "1/2-1/2" ? PGN_DRAW : PGN_UNKNOWN;
+            break;
+        }
+
+        // move numbers, possibly glued to the move (1.e4, 12...Nf6)
+        if (std::isdigit((unsigned char)t.front()) && t.compare(0, 3, "0-0") != 0) {
+            while (!t.empty() && (std::isdigit((unsigned char)t.front()) || t.front() == '.'))
+                t.remove_prefix(1);
+            if (t.empty())
+                continue;
+        }
+
+        if (game.error)
+            continue;
+        Move m = san_to_move(B, t);
+        if (!m) {
+            game.error = true;
+            continue;
+        }
+        B.make_move(m);
+        game.moves.push_back(m);
+    }
+
+    if (game.result == PGN_UNKNOWN) {
+        std::string_view result = game.tag("Result");
+        if (result == "1-0")
+            game.result = PGN_WHITE_WINS;
+        else if (result == "0-1")
+            game.result = PGN_BLACK_WINS;
+        else if (result == "1/2-1/2")
+            game.result = PGN_DRAW;
+    }
+    return true;
+}
+
+///////////////////////////////////////////////////////////
+//                        Writer                         //
+///////////////////////////////////////////////////////////
+
+static const char* result_str(int result) {
+    switch (result) {
+        case PGN_WHITE_WINS: return "1-0";
+        case PGN_BLACK_WINS: return "0-1";
+        case PGN_DRAW: return "1/2-1/2";
+        default: return "*";
+    }
+}
+
+static void write_tag(std::ostream& out, const std::string& name, const std::string& value) {
+    out << '[' << name << " \"";
+    for (char c : value) {
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+    out << "\"]\n";
+}
+
+void write_pgn(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& tags,
+               const std::string& fen, const std::vector<Move>& moves, int result) {
+    auto has_tag = [&tags](const char* name) {
+        for (auto& t : tags)
+            if (t.first == name)
+                return true;
+        return false;
+    };
+
+    for (auto& t : tags)
+        write_tag(out, t.first, t.second);
+    if (!has_tag("Result"))
+        write_tag(out, "Result", result_str(result));
+    if (!has_tag("Variant"))
+        write_tag(out, "Variant", "Three-check");
+
+    Boardstate B;
+    int move_number = 1;
+    if (fen.empty()) {
+        B.reset();
+    } else {
+        B.set_fen(fen);
+        if (!has_tag("FEN")) {
+            write_tag(out, "SetUp", "1");
+            write_tag(out, "FEN", fen);
+        }
+
+        // the fullmove number, if the fen has one
+        size_t last = fen.find_last_of(' ');
+        if (last != std::string::npos && std::count(fen.begin(), fen.end(), ' ') >= 5)
+            move_number = std::max(std::atoi(fen.c_str() + last + 1), 1);
+    }
+    out << '\n';
+
+    // movetext lines are kept under 80 characters
+    std::string line;
+    auto append = [&](const std::string& word) {
+        if (!line.empty() && line.size() + 1 + word.size() > 79) {
+            out << line << '\n';
+            line.clear();
+        }
+        if (!line.empty())
+            line += ' ';
+        line += word;
+    };
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        if (B.to_move == WHITE)
+            append(std::to_string(move_number) + ". " + move_to_san(B, moves[i]));
+        else if (i == 0)
+            append(std::to_string(move_number) + "... " + move_to_san(B, moves[i]));
+        else
+            append(move_to_san(B, moves[i]));
+
+        if (B.to_move == BLACK)
+            move_number++;
+        B.make_move(moves[i]);
+    }
+    append(result_str(result));
+    out << line << "\n\n";
+}
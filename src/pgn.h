@@ -0,0 +1,71 @@
+#ifndef _PGN_H_
+#define _PGN_H_
+
+#include "boardstate.h"
+#include "move.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// standard algebraic notation of m, a legal move of B (Nf3, exd6, O-O, e8=Q+)
+std::string move_to_san(const Boardstate& B, Move m);
+
+// the legal move of B written as san (check marks and annotations are
+// ignored), 0 if there is none or it is ambiguous
+Move san_to_move(const Boardstate& B, std::string_view san);
+
+enum {
+    PGN_WHITE_WINS = 1,
+    PGN_BLACK_WINS = -1,
+    PGN_DRAW = 0,
+    PGN_UNKNOWN = 2         // "*" or no result
+};
+
+// one game of a pgn file, tags are views into the mapped file and are
+// only valid until the next call of PgnReader::next
+struct pgn_game {
+    std::vector<std::pair<std::string_view, std::string_view>> tags;
+    Boardstate start;               // FEN tag or the initial position
+    std::vector<Move> moves;        // main line, up to the first bad move
+    int result = PGN_UNKNOWN;
+    bool error = false;             // bad FEN or a move that didn't decode
+
+    // value of tag name, empty if missing
+    std::string_view tag(std::string_view name) const;
+};
+
+// Reads games one at a time from a memory mapped file, so files of any
+// size are streamed without being loaded; comments, variations, NAGs
+// and move numbers are skipped.
+class PgnReader
+{
+  public:
+    explicit PgnReader(const std::string& path);
+    ~PgnReader();
+    PgnReader(const PgnReader&) = delete;
+    PgnReader& operator=(const PgnReader&) = delete;
+
+    bool is_open() const;
+
+    // false at the end of the file
+    bool next(pgn_game& game);
+
+  private:
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    size_t released = 0;        // pages before it were given back
+
+    void skip_space();
+    std::string_view token();
+};
+
+// writes one game, fen is the starting position (empty for the initial
+// one), tags are written first in the given order; Variant, SetUp/FEN
+// and Result are added when missing
+void write_pgn(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& tags,
+               const std::string& fen, const std::vector<Move>& moves, int result);
+
+#endif
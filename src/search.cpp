@@ -3,97 +3,362 @@
 #include "evaluate.h"
 #include "move_gen.h"
 #include "transpositions.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
 
-static int depth = 6;
+// the clock is only read every CHECK_INTERVAL nodes
+#define CHECK_INTERVAL 1024
 
-void set_search_depth(const int x) {
-    depth = x;
+void SearchContext::set_depth(const int x) {
+    root_depth = x;
 }
 
+void SearchContext::set_stop(bool stop) {
+    stop_flag.store(stop, std::memory_order_relaxed);
+}
+
+inline int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>
+           (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SearchContext::set_time(uint32_t soft_time, uint32_t hard_time) {
+    int64_t now = now_ms();
+    soft_deadline.store(soft_time ? now + soft_time : 0, std::memory_order_relaxed);
+    hard_deadline.store(hard_time ? now + hard_time : 0, std::memory_order_relaxed);
+}
+
+inline bool SearchContext::stopped() const {
+    return limit_hit || stop_flag.load(std::memory_order_relaxed);
+}
+
+// node limit is exact, the clock is only read every CHECK_INTERVAL nodes
+inline void SearchContext::count_node() {
+    stats.nodes++;
+    if (node_limit != 0 && stats.nodes >= node_limit)
+        limit_hit = true;
+
+    if (--check_countdown <= 0) {
+        check_countdown = CHECK_INTERVAL;
+        int64_t deadline = hard_deadline.load(std::memory_order_relaxed);
+        if (deadline != 0 && now_ms() >= deadline)
+            limit_hit = true;
+    }
+}
+
+// i is the index of the move in the ordered list
+inline void SearchContext::count_cutoff(int i) {
+    stats.beta_cutoffs++;
+    stats.cutoff_index[std::min(i, CUTOFF_SLOTS - 1)]++;
+}
+
+const search_stats& SearchContext::get_stats() const {
+    return stats;
+}
+
+std::string stats_to_str(const search_stats& s) {
+    auto percent = [](uint64_t part, uint64_t total) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%.1f%%", total ? 100.0 * part / total : 0.0);
+        return std::string(buf);
+    };
+    std::string str = "nodes " + std::to_string(s.nodes)
+        + " qnodes " + std::to_string(s.qnodes) + " (" + percent(s.qnodes, s.nodes) + ")"
+        + " tthits " + percent(s.tt_hits, s.tt_probes)
+        + " ttcutoffs " + std::to_string(s.tt_cutoffs)
+        + " cutoffs " + std::to_string(s.beta_cutoffs)
+        + " first " + percent(s.cutoff_index[0], s.beta_cutoffs)
+        + " index";
+    for (int i = 0; i < CUTOFF_SLOTS; i++)
+        str += " " + std::to_string(s.cutoff_index[i]);
+    return str;
+}
+
+///////////////////////////////////////////////////////////
+//                 Repetition detection                  //
+///////////////////////////////////////////////////////////
+
+void SearchContext::clear_game_history() {
+    hash_history.clear();
+    game_length = 0;
+}
+
+void SearchContext::push_game_history(uint64_t hash) {
+    hash_history.resize(game_length);
+    hash_history.push_back(hash);
+    game_length++;
+}
+
+void SearchContext::pop_game_history() {
+    if (game_length > 0)
+        game_length--;
+}
+
+// records B at ply and looks for an earlier occurrence, only positions
+// with the same side to move since the last irreversible move can match
+bool SearchContext::is_repetition(const Boardstate& B, const int ply) {
+    int current = game_length + ply;
+    hash_history[current] = B.hash;
+
+    int oldest = std::max(current - (int)B.halfmove_clock, 0);
+    for (int i = current - 4; i >= oldest; i -= 2)
+        if (hash_history[i] == B.hash)
+            return true;
+
+    return false;
+}
+
+// returned for moves leaving the king in check, indexed by the side that moved
 constexpr int illegal_move[] = {
     INT32_MIN + 1, INT32_MAX - 1
 };
 
-constexpr int win[] = {
-    INT32_MAX - 2, INT32_MIN + 2
-};
+int SearchContext::get_score() const {
+    return last_score;
+}
+
+///////////////////////////////////////////////////////////
+//                     Mate scores                       //
+///////////////////////////////////////////////////////////
 
-int quiescence(const Boardstate& B, int alpha, int beta);
+// 3-check win (or checkmate) for result 1 (white) or 2 (black) at ply,
+// faster wins score higher
+inline int win_score(int result, int ply) {
+    return result == 1 ? MATE_SCORE - ply : -MATE_SCORE + ply;
+}
+
+// score of a node without legal moves, checkmate or stalemate
+inline int no_moves_score(const Boardstate& B, int ply) {
+    if (!is_attacked(B, lsb(B.pieces[B.to_move][KING])))
+        return 0;
+    return win_score(B.to_move == WHITE ? 2 : 1, ply);
+}
+
+// mate scores are stored relative to the node, not to the root,
+// so they stay valid when the position is reached at another ply
+inline int score_to_tt(int score, int ply) {
+    if (score > MATE_BOUND && score <= MATE_SCORE)
+        return score + ply;
+    if (score < -MATE_BOUND && score >= -MATE_SCORE)
+        return score - ply;
+    return score;
+}
+
+inline int score_from_tt(int score, int ply) {
+    if (score > MATE_BOUND && score <= MATE_SCORE)
+        return score - ply;
+    if (score < -MATE_BOUND && score >= -MATE_SCORE)
+        return score + ply;
+    return score;
+}
+
+///////////////////////////////////////////////////////////
+//                    Move ordering                      //
+///////////////////////////////////////////////////////////
+
+// generators score captures, promotions and checks,
+// the rest is filled in from the tt, killers and history
+void SearchContext::order_moves(const Boardstate& B, move_list& moves, Move tt_move, int ply) {
+    ply = std::min(ply, MAX_PLY - 1);
+    for (int i = 0; i < moves.captures.count; i++)
+        if (moves.captures.arr[i] == tt_move)
+            moves.captures.scores[i] = TT_MOVE_SCORE;
+
+    for (int i = 0; i < moves.quiet.count; i++) {
+        Move m = moves.quiet.arr[i];
+        if (m == tt_move)
+            moves.quiet.scores[i] = TT_MOVE_SCORE;
+        else if (m == killer_moves[ply][0])
+            moves.quiet.scores[i] = KILLER_SCORE;
+        else if (m == killer_moves[ply][1])
+            moves.quiet.scores[i] = KILLER_SCORE - 1;
+        else if (moves.quiet.scores[i] == 0)
+            moves.quiet.scores[i] = history[B.to_move][get_src(m)][get_dest(m)];
+    }
+}
+
+// captures first, then quiet moves, best scored first in both
+inline Move pick_move(move_list& moves, int i) {
+    if (i < moves.captures.count)
+        return moves.captures.pick(i);
+    return moves.quiet.pick(i - moves.captures.count);
+}
+
+// killers and history only learn from moves that neither capture nor
+// promote, whichever list the generator put them in
+inline bool is_quiet(const Boardstate& B, Move m) {
+    return B.piece_on[get_dest(m)] == NULL_PIECE &&
+           get_special(m) != ENPASSANT && get_special(m) != PROMOTION;
+}
+
+void SearchContext::update_quiet_stats(color c, Move m, int depth, int ply) {
+    ply = std::min(ply, MAX_PLY - 1);
+    if (killer_moves[ply][0] != m) {
+        killer_moves[ply][1] = killer_moves[ply][0];
+        killer_moves[ply][0] = m;
+    }
+
+    int16_t& h = history[c][get_src(m)][get_dest(m)];
+    h = std::min(h + depth * depth, (int)HISTORY_MAX);
+}
+
+void SearchContext::clear_move_stats() {
+    std::memset(killer_moves, 0, sizeof(killer_moves));
+    std::memset(history, 0, sizeof(history));
+}
+
+void SearchContext::age_move_stats() {
+    std::memset(killer_moves, 0, sizeof(killer_moves));
+    for (auto& side : history)
+        for (auto& from : side)
+            for (auto& h : from)
+                h /= 2;
+}
 
 ///////////////////////////////////////////////////////////
 //          Minimax with Alpha/Beta prunning             //
 //           @ <= Performance Critical => @              //
 ///////////////////////////////////////////////////////////
 
-int search(Boardstate B, const Move m, const int depth, int alpha, int beta) {
+int SearchContext::search(Boardstate B, const Move m, const int depth, int alpha, int beta,
+           move_list* arena, const int ply) {
+    if (stopped())
+        return 0;
+
     // make move
     if (!B.make_move(m))
         return illegal_move[B.to_move];
 
+    count_node();
+
     auto result = B.get_result();
     if (result != 0)
-        return win[result - 1];
+        return win_score(result, ply);
+
+    // 50 move rule -> draw, unless the move that got there mated
+    if (B.halfmove_clock >= 100) {
+        if (is_attacked(B, lsb(B.pieces[B.to_move][KING])) && !has_legal_move(B))
+            return no_moves_score(B, ply);
+        return 0;
+    }
+
+    // repetition -> draw
+    if (is_repetition(B, ply))
+        return 0;
+
+    // mate distance pruning, no line from here can beat a win
+    // already found closer to the root
+    if (MATE_SCORE - ply <= alpha)
+        return alpha;
+    if (-MATE_SCORE + ply >= beta)
+        return beta;
     
     // static evaluation
-    if (depth == 0)
-        return quiescence(B, alpha, beta);
+    if (depth == 0 || ply >= MAX_PLY)
+        return quiescence(B, alpha, beta, arena, ply);
+
+    auto& entry = tt.get_entry(B.hash);
+    Move tt_move = 0;
+    stats.tt_probes++;
+    if (entry.zobrist == B.hash) {
+        stats.tt_hits++;
+        tt_move = entry.best_move;
+        if (entry.depth >= depth) {
+            int tt_score = score_from_tt(entry.score, ply);
+            if (entry.flag == EXACT) {
+                stats.tt_cutoffs++;
+                return std::clamp(tt_score, alpha, beta);
+            }
+            if (entry.flag == LOWER_BOUND && tt_score >= beta) {
+                stats.tt_cutoffs++;
+                return beta;
+            }
+            if (entry.flag == UPPER_BOUND && tt_score <= alpha) {
+                stats.tt_cutoffs++;
+                return alpha;
+            }
+        }
+    }
     
-    move_list moves;
+    move_list& moves = arena[ply];
+    moves.clear();
     generate_all_moves(B, moves);
+    order_moves(B, moves, tt_move, ply);
 
-    // if there are no moves or 50 move rule -> stalemate
-    if ((moves.captures.count == 0 && moves.quiet.count == 0) || B.no_capture_count >= 50)
-        return 0;
+    int move_count = moves.captures.count + moves.quiet.count;
+    int legal_moves = 0;
+    Move best_move = 0;
 
     if (B.to_move == WHITE) {
-        // search captures
-        for (auto next_move : moves.captures) {
-            auto curr_eval = search(B, next_move, depth - 1, alpha, beta);
-            if (curr_eval > alpha) {
-                alpha = curr_eval;
-                if (beta <= alpha) {
-                    return beta;
-                }
-            }
-        }
-        // search quiet moves
-        for (auto next_move : moves.quiet) {
-            auto curr_eval = search(B, next_move, depth - 1, alpha, beta);
+        for (int i = 0; i < move_count; i++) {
+            Move next_move = pick_move(moves, i);
+            auto curr_eval = search(B, next_move, depth - 1, alpha, beta, arena, ply + 1);
+            if (stopped())
+                return 0;
+            if (curr_eval == illegal_move[WHITE])
+                continue;
+
+            legal_moves++;
             if (curr_eval > alpha) {
                 alpha = curr_eval;
+                best_move = next_move;
                 if (beta <= alpha) {
+                    count_cutoff(i);
+                    if (is_quiet(B, next_move))
+                        update_quiet_stats(WHITE, next_move, depth, ply);
+                    tt.store_entry(B.hash, next_move, depth, LOWER_BOUND, score_to_tt(beta, ply));
                     return beta;
                 }
             }
         }
+
+        // checkmate or stalemate
+        if (legal_moves == 0)
+            return std::clamp(no_moves_score(B, ply), alpha, beta);
        
+        if (best_move != 0)
+            tt.store_entry(B.hash, best_move, depth, EXACT, score_to_tt(alpha, ply));
+        else
+            tt.store_entry(B.hash, tt_move, depth, UPPER_BOUND, score_to_tt(alpha, ply));
         return alpha;
     
     } else {
 
-        // search captures
-        for (auto next_move : moves.captures) {
-            auto curr_eval = search(B, next_move, depth - 1, alpha, beta);
-            if (curr_eval < beta) {
-                beta = curr_eval;
-                if (beta <= alpha) {
-                    return alpha;
-                }
-            }
-        }
-        // search quiet moves
-        for (auto next_move : moves.quiet) {
-            auto curr_eval = search(B, next_move, depth - 1, alpha, beta);
+        for (int i = 0; i < move_count; i++) {
+            Move next_move = pick_move(moves, i);
+            auto curr_eval = search(B, next_move, depth - 1, alpha, beta, arena, ply + 1);
+            if (stopped())
+                return 0;
+            if (curr_eval == illegal_move[BLACK])
+                continue;
+
+            legal_moves++;
             if (curr_eval < beta) {
                 beta = curr_eval;
+                best_move = next_move;
                 if (beta <= alpha) {
+                    count_cutoff(i);
+                    if (is_quiet(B, next_move))
+                        update_quiet_stats(BLACK, next_move, depth, ply);
+                    tt.store_entry(B.hash, next_move, depth, UPPER_BOUND, score_to_tt(alpha, ply));
                     return alpha;
                 }
             }
-            
         }
+
+        // checkmate or stalemate
+        if (legal_moves == 0)
+            return std::clamp(no_moves_score(B, ply), alpha, beta);
         
+        if (best_move != 0)
+            tt.store_entry(B.hash, best_move, depth, EXACT, score_to_tt(beta, ply));
+        else
+            tt.store_entry(B.hash, tt_move, depth, LOWER_BOUND, score_to_tt(beta, ply));
         return beta;
     }
 }
@@ -102,88 +367,190 @@ int search(Boardstate B, const Move m, const int depth, int alpha, int beta) {
 //       Initial search part, returns best Move          //
 ///////////////////////////////////////////////////////////
 
-Move search(const Boardstate& B) { 
+Move SearchContext::search(const Boardstate& B, const std::vector<Move>& excluded) {
+    // per-ply move buffers for the whole search, kept out of the
+    // recursive frames so deep searches only touch one list per ply
+    move_list arena[MAX_PLY];
+
     // generate possible moves
-    move_list moves;
+    move_list& moves = arena[0];
     generate_all_moves(B, moves);
 
     // return null move if there are no moves
-    if (moves.captures.count == 0 && moves.quiet.count == 0)
+    if (moves.captures.count == 0 && moves.quiet.count == 0) {
+        last_score = no_moves_score(B, 0);
         return 0;
+    }
+
+    hash_history.resize(game_length + MAX_PLY + 1);
+    hash_history[game_length] = B.hash;
+    auto& entry = tt.get_entry(B.hash);
+    Move tt_move = entry.zobrist == B.hash ? entry.best_move : 0;
+    order_moves(B, moves, tt_move, 0);
 
     // initialize alpha beta
     int alpha = INT32_MIN;
     int beta = INT32_MAX;
 
+    int move_count = moves.captures.count + moves.quiet.count;
     Move best_move = 0;
     if (B.to_move == WHITE) {
-        // search captures
-        for (auto i = 0; i < moves.captures.count; i++) {
-            int curr_eval = search(B, moves.captures.arr[i], depth - 1, alpha, beta);
-            if (curr_eval > alpha) {
-                alpha = curr_eval;
-                best_move = moves.captures.arr[i];
-            }
-        }
-        // search quiet moves
-        for (auto i = 0; i < moves.quiet.count; i++) {
-            int curr_eval = search(B, moves.quiet.arr[i], depth - 1, alpha, beta);
-            if (curr_eval > alpha) {
+        for (int i = 0; i < move_count; i++) {
+            Move next_move = pick_move(moves, i);
+            if (std::find(excluded.begin(), excluded.end(), next_move) != excluded.end())
+                continue;
+
+            int curr_eval = search(B, next_move, root_depth - 1, alpha, beta, arena, 1);
+            if (stopped())
+                break;
+            if (curr_eval != illegal_move[WHITE] && curr_eval > alpha) {
                 alpha = curr_eval;
-                best_move = moves.quiet.arr[i];
-            }
-        }
-        
-        if (best_move == 0) {
-            for (auto i = 0; i < moves.captures.count; i++) {
-                Boardstate B_cpy = B;
-                auto m = moves.captures.arr[i];
-                if (B_cpy.make_move(m))
-                    return m;
-            }
-            for (auto i = 0; i < moves.quiet.count; i++) {
-                Boardstate B_cpy = B;
-                auto m = moves.quiet.arr[i];
-                if (B_cpy.make_move(m))
-                    return m;
+                best_move = next_move;
             }
         }
-        return best_move;
+        last_score = alpha;
     
     } else {
 
-        // search captures
-        for (auto i = 0; i < moves.captures.count; i++) {
-            int curr_eval = search(B, moves.captures.arr[i], depth - 1, alpha, beta);
-            if (curr_eval < beta) {
+        for (int i = 0; i < move_count; i++) {
+            Move next_move = pick_move(moves, i);
+            if (std::find(excluded.begin(), excluded.end(), next_move) != excluded.end())
+                continue;
+
+            int curr_eval = search(B, next_move, root_depth - 1, alpha, beta, arena, 1);
+            if (stopped())
+                break;
+            if (curr_eval != illegal_move[BLACK] && curr_eval < beta) {
                 beta = curr_eval;
-                best_move = moves.captures.arr[i];
+                best_move = next_move;
             }
         }
-        // search quiet moves
-        for (auto i = 0; i < moves.quiet.count; i++) {
-            int curr_eval = search(B, moves.quiet.arr[i], depth - 1, alpha, beta);
-            if (curr_eval < beta) {
-                beta = curr_eval;
-                best_move = moves.quiet.arr[i];
-            }
+        last_score = beta;
+    }
+
+    // no legal moves
+    if (best_move == 0 && !stopped()) {
+        last_score = no_moves_score(B, 0);
+        return 0;
+    }
+
+    // stopped before any move got a score, play the first legal one
+    // in move order so there is always a move while the game goes on
+    if (best_move == 0) {
+        for (int i = 0; i < move_count && best_move == 0; i++) {
+            Move next_move = pick_move(moves, i);
+            Boardstate child = B;
+            if (std::find(excluded.begin(), excluded.end(), next_move) == excluded.end() &&
+                child.make_move(next_move))
+                best_move = next_move;
         }
-        if (best_move == 0) {
-            for (auto i = 0; i < moves.captures.count; i++) {
-                Boardstate B_cpy = B;
-                auto m = moves.captures.arr[i];
-                if (B_cpy.make_move(m))
-                    return m;
-            }
-            for (auto i = 0; i < moves.quiet.count; i++) {
-                Boardstate B_cpy = B;
-                auto m = moves.quiet.arr[i];
-                if (B_cpy.make_move(m))
-                    return m;
+        last_score = evaluate(B);
+    }
+
+    // the root entry keeps the best line
+    if (!stopped() && excluded.empty())
+        tt.store_entry(B.hash, best_move, root_depth, EXACT, last_score);
+    return best_move;
+}
+
+std::vector<Move> SearchContext::get_pv(Boardstate B, int max_length) {
+    std::vector<Move> pv;
+    while ((int)pv.size() < max_length) {
+        auto& entry = tt.get_entry(B.hash);
+        if (entry.zobrist != B.hash || entry.best_move == 0)
+            break;
+
+        // the entry could be a hash collision, only follow generated moves
+        move_list moves;
+        generate_all_moves(B, moves);
+        Move m = entry.best_move;
+        if (std::find(moves.captures.begin(), moves.captures.end(), m) == moves.captures.end() &&
+            std::find(moves.quiet.begin(), moves.quiet.end(), m) == moves.quiet.end())
+            break;
+
+        if (!B.make_move(m))
+            break;
+        pv.push_back(m);
+    }
+    return pv;
+}
+
+///////////////////////////////////////////////////////////
+//     Iterative deepening, reports every iteration      //
+///////////////////////////////////////////////////////////
+
+Move SearchContext::think(const Boardstate& B, const search_limits& limits, const report_callback& report) {
+    int64_t start = now_ms();
+    if (limits.soft_time != 0 || limits.hard_time != 0)
+        set_time(limits.soft_time, limits.hard_time);
+    node_limit = limits.nodes;
+    limit_hit = false;
+    check_countdown = CHECK_INTERVAL;
+    age_move_stats();
+    stats = search_stats();
+
+    Move best_move = 0;
+    int best_score = 0;
+    for (int d = 1; d <= limits.depth; d++) {
+        set_depth(d);
+
+        // multi-pv: every line is a root search without the moves of
+        // the lines before it, the tt is shared between them
+        std::vector<Move> excluded;
+        std::vector<std::pair<int, std::vector<Move>>> lines;
+        Move m = 0;
+        for (int k = 0; k < std::max(limits.multipv, 1); k++) {
+            Move line_move = search(B, excluded);
+            if (stopped() || line_move == 0) {
+                if (k == 0)
+                    m = line_move;
+                break;
             }
+
+            Boardstate child = B;
+            child.make_move(line_move);
+            std::vector<Move> pv = {line_move};
+            for (auto next : get_pv(child, d - 1))
+                pv.push_back(next);
+
+            if (k == 0)
+                m = line_move;
+            excluded.push_back(line_move);
+            lines.push_back({last_score, pv});
+        }
+
+        // an interrupted iteration is only used if there is nothing else
+        if (stopped() && best_move != 0)
+            break;
+
+        best_move = m;
+        best_score = lines.empty() ? last_score : lines[0].first;
+
+        int64_t now = now_ms();
+        uint32_t elapsed = now - start;
+        if (report) {
+            int hashfull = tt.hashfull();
+            for (int k = 0; k < (int)lines.size(); k++)
+                report({d, lines[k].first, elapsed, stats.nodes, lines[k].second, k + 1,
+                        hashfull, stats});
         }
-        return best_move;
+
+        if (m == 0 || stopped())
+            break;
+
+        // a forced win won't get any shorter by searching deeper
+        int score = B.to_move == WHITE ? best_score : -best_score;
+        if (score > MATE_BOUND)
+            break;
+
+        int64_t deadline = soft_deadline.load(std::memory_order_relaxed);
+        if (deadline != 0 && now >= deadline)
+            break;
     }
+
+    set_time(0, 0);
+    last_score = best_score;
+    return best_move;
 }
 
 ////////////////////////////////////////////////////////////
@@ -191,16 +558,26 @@ Move search(const Boardstate& B) {
 //   https://www.chessprogramming.org/Quiescence_Search   //
 ////////////////////////////////////////////////////////////
 
-int q_search(Boardstate B, const Move m, int alpha, int beta) {
+int SearchContext::q_search(Boardstate B, const Move m, int alpha, int beta, move_list* arena, const int ply) {
     if (!B.make_move(m))
         return illegal_move[B.to_move];
+
+    count_node();
+    stats.qnodes++;
+
+    auto result = B.get_result();
+    if (result != 0)
+        return win_score(result, ply);
+
+    if (ply >= MAX_PLY)
+        return evaluate(B);
     
-    move_array<64> moves;
+    auto& moves = arena[ply].captures;
+    moves.clear();
     generate_capture_moves(B, moves);
 
-    auto result = B.get_result();
-    if (result != 0 || moves.count == 0)
-        return win[result - 1];
+    if (moves.count == 0)
+        return evaluate(B);
 
     if (B.to_move == WHITE) {
     
@@ -211,8 +588,8 @@ int q_search(Boardstate B, const Move m, int alpha, int beta) {
             alpha = stand_pat;
 
         int curr_eval = 0;
-        for (auto m : moves) {
-            curr_eval = q_search(B, m, alpha, beta);
+        for (int i = 0; i < moves.count; i++) {
+            curr_eval = q_search(B, moves.pick(i), alpha, beta, arena, ply + 1);
             alpha = std::max(alpha, curr_eval);
             if (beta <= alpha)
                 return beta;
@@ -228,8 +605,8 @@ int q_search(Boardstate B, const Move m, int alpha, int beta) {
             beta = stand_pat;
 
         int curr_eval = 0;
-        for (auto m : moves) {
-            curr_eval = q_search(B, m, alpha, beta);
+        for (int i = 0; i < moves.count; i++) {
+            curr_eval = q_search(B, moves.pick(i), alpha, beta, arena, ply + 1);
             beta = std::min(beta, curr_eval);
             if (beta <= alpha)
                 return alpha;
@@ -238,8 +615,12 @@ int q_search(Boardstate B, const Move m, int alpha, int beta) {
     }
 }
 
-int quiescence(const Boardstate& B, int alpha, int beta){
-    move_array<64> moves;
+int SearchContext::quiescence(const Boardstate& B, int alpha, int beta, move_list* arena, const int ply) {
+    if (ply >= MAX_PLY)
+        return evaluate(B);
+
+    auto& moves = arena[ply].captures;
+    moves.clear();
     generate_capture_moves(B, moves);
 
     if (moves.count == 0)
@@ -254,8 +635,8 @@ int quiescence(const Boardstate& B, int alpha, int beta){
             alpha = stand_pat;
 
         int curr_eval = 0;
-        for (auto m : moves) {
-            curr_eval = q_search(B, m, alpha, beta);
+        for (int i = 0; i < moves.count; i++) {
+            curr_eval = q_search(B, moves.pick(i), alpha, beta, arena, ply + 1);
             alpha = std::max(alpha, curr_eval);
             if (beta <= alpha)
                 return beta;
@@ -271,8 +652,8 @@ int quiescence(const Boardstate& B, int alpha, int beta){
             beta = stand_pat;
 
         int curr_eval = 0;
-        for (auto m : moves) {
-            curr_eval = q_search(B, m, alpha, beta);
+        for (int i = 0; i < moves.count; i++) {
+            curr_eval = q_search(B, moves.pick(i), alpha, beta, arena, ply + 1);
             beta = std::min(beta, curr_eval);
             if (beta <= alpha)
                 return alpha;
@@ -2,8 +2,169 @@
 #define __SEARCH_H_
 
 #include "move_gen.h"
+#include "transpositions.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
 
-void set_search_depth(const int depth);
-Move search(const Boardstate& B);
+#define MAX_PLY 64
+
+// 3-check wins and checkmates score MATE_SCORE - ply (white relative),
+// anything beyond MATE_BOUND is a forced win
+#define MATE_SCORE 1000000
+#define MATE_BOUND (MATE_SCORE - 1000)
+
+// beta cutoffs by the index of the move that caused them,
+// the last slot collects every later move
+#define CUTOFF_SLOTS 8
+
+// counters of one search, reset when think() starts
+struct search_stats {
+    uint64_t nodes = 0;         // search and quiescence
+    uint64_t qnodes = 0;        // quiescence only
+    uint64_t tt_probes = 0;
+    uint64_t tt_hits = 0;       // entry of the same position found
+    uint64_t tt_cutoffs = 0;    // node answered by the entry's bound
+    uint64_t beta_cutoffs = 0;
+    uint64_t cutoff_index[CUTOFF_SLOTS] = {};
+
+    search_stats& operator+=(const search_stats& other) {
+        nodes += other.nodes;
+        qnodes += other.qnodes;
+        tt_probes += other.tt_probes;
+        tt_hits += other.tt_hits;
+        tt_cutoffs += other.tt_cutoffs;
+        beta_cutoffs += other.beta_cutoffs;
+        for (int i = 0; i < CUTOFF_SLOTS; i++)
+            cutoff_index[i] += other.cutoff_index[i];
+        return *this;
+    }
+};
+
+// one line summary, e.g. for the log or uci info string
+std::string stats_to_str(const search_stats& stats);
+
+// sent after every completed iteration
+struct search_info {
+    int depth;
+    int score;              // white relative
+    uint32_t time;          // milliseconds since the search started
+    uint64_t nodes;
+    std::vector<Move> pv;
+    int multipv = 1;        // line number, 1 is the best
+    int hashfull = 0;       // permille of the transposition table in use
+    search_stats stats;
+};
+
+typedef std::function<void(const search_info&)> report_callback;
+
+struct search_limits {
+    int depth = MAX_PLY - 1;
+    uint64_t nodes = 0;         // abort after this many nodes, 0 = none
+    uint32_t soft_time = 0;     // ms, no iteration is started after it, 0 = none
+    uint32_t hard_time = 0;     // ms, abort the search, 0 = none
+    int multipv = 1;            // number of best lines reported
+};
+
+// Everything one game (or analysis job) needs besides the board: the
+// transposition table, move ordering tables, game history, limits and
+// stop flag. Contexts are independent, one per thread can search at the
+// same time; the attack, evaluation and zobrist tables are shared and
+// read only once initialized.
+class SearchContext
+{
+  public:
+    TransTable tt;
+
+    SearchContext() = default;
+    explicit SearchContext(size_t hash_mb) : tt(hash_mb) {}
+    SearchContext(const SearchContext&) = delete;
+    SearchContext& operator=(const SearchContext&) = delete;
+
+    // depth of search() below, think() sets it for every iteration
+    void set_depth(int depth);
+
+    // positions reached before the one being searched, oldest first,
+    // checked together with the search path for repetitions
+    void clear_game_history();
+    void push_game_history(uint64_t hash);
+    void pop_game_history();
+
+    // forgets killer moves and history, kept between searches otherwise
+    void clear_move_stats();
+
+    // single search to the depth set above, root moves in excluded
+    // are skipped (multi-pv)
+    Move search(const Boardstate& B, const std::vector<Move>& excluded = {});
+
+    // white relative score of the last search, 0 if it found no move
+    int get_score() const;
+
+    // counters of the last search
+    const search_stats& get_stats() const;
+
+    // iterative deepening within limits, stops early on a forced win
+    // or on set_stop(true); report gets every line of every
+    // completed iteration, best first
+    Move think(const Boardstate& B, const search_limits& limits,
+               const report_callback& report = nullptr);
+
+    // replaces the time limits of the running search, counted from now
+    // (used on ponderhit), safe to call from another thread; a search
+    // without time limits keeps deadlines set before it started, they
+    // are cleared when think() returns
+    void set_time(uint32_t soft_time, uint32_t hard_time);
+
+    // safe to call from another thread, the search returns the best move
+    // of the last completed iteration; clear it before the next search
+    void set_stop(bool stop);
+
+    // principal variation from the transposition table
+    std::vector<Move> get_pv(Boardstate B, int max_length);
+
+  private:
+    int root_depth = 6;
+
+    // set from another thread to abort the running search
+    std::atomic<bool> stop_flag{false};
+
+    search_stats stats;
+
+    // limits of the running search, deadlines are steady clock
+    // milliseconds (0 = none) and can be moved from another thread
+    std::atomic<int64_t> soft_deadline{0};
+    std::atomic<int64_t> hard_deadline{0};
+    uint64_t node_limit = 0;
+    bool limit_hit = false;
+    int check_countdown = 0;
+
+    // quiet moves which caused a beta cutoff, two per ply
+    Move killer_moves[MAX_PLY][2] = {};
+    // [color][src][dest], bumped by depth^2 on quiet beta cutoffs
+    int16_t history[2][64][64] = {};
+
+    // game positions followed by the current search path,
+    // hash_history[game_length + ply] is the position at ply
+    std::vector<uint64_t> hash_history;
+    int game_length = 0;
+
+    // score of the last root search, white relative
+    int last_score = 0;
+
+    bool stopped() const;
+    void count_node();
+    void count_cutoff(int i);
+    bool is_repetition(const Boardstate& B, int ply);
+
+    void order_moves(const Boardstate& B, move_list& moves, Move tt_move, int ply);
+    void update_quiet_stats(color c, Move m, int depth, int ply);
+    void age_move_stats();
+
+    // arena holds one move_list per ply, owned by the root search
+    int search(Boardstate B, Move m, int depth, int alpha, int beta, move_list* arena, int ply);
+    int q_search(Boardstate B, Move m, int alpha, int beta, move_list* arena, int ply);
+    int quiescence(const Boardstate& B, int alpha, int beta, move_list* arena, int ply);
+};
 
 #endif
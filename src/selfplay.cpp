@@ -0,0 +1,579 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "boardstate.h"
+#include "evaluate.h"
+#include "move.h"
+#include "move_gen.h"
+#include "pgn.h"
+#include "zobrist.h"
+
+using namespace std;
+
+// Headless engine vs engine 3-check matches over UCI. Every opening is played
+// twice with colors swapped, games run concurrently (two engine processes per
+// worker) and the match stops early once the SPRT accepts a hypothesis.
+// The runner keeps its own board to check moves and adjudicate results.
+
+#define MAX_PLIES 400           // longer games are adjudicated as draws
+#define READY_TIMEOUT 10000     // ms for uciok / readyok
+#define MOVE_MARGIN 1000        // ms an engine may overstep its clock
+
+///////////////////////////////////////////////////////////
+//                   Match configuration                 //
+///////////////////////////////////////////////////////////
+
+struct engine_config {
+    string path = "./engine";
+    vector<pair<string, string>> options;      // setoption name, value
+};
+
+struct match_config {
+    engine_config engines[2];
+    vector<string> openings;    // fens, startpos if empty
+    int games = 1000;
+    int concurrency = 1;
+
+    // per move limits sent with go, clocks if base_time is set
+    int64_t base_time = 0, increment = 0;
+    int64_t movetime = 0;
+    uint64_t nodes = 0;
+    int depth = 0;
+
+    // sprt on the logistic elo difference of engine 1
+    bool sprt = false;
+    double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+
+    // every finished game is appended here if set
+    string pgn_file;
+};
+
+///////////////////////////////////////////////////////////
+//                    Engine processes                   //
+///////////////////////////////////////////////////////////
+
+struct engine_process {
+    pid_t pid = -1;
+    int to_engine = -1, from_engine = -1;
+    string buffer;
+
+    bool start(const string& path) {
+        // close on exec, or engines started by other workers would keep
+        // our pipes open and a crash would never show up as end of file
+        int in[2], out[2];
+        if (pipe2(in, O_CLOEXEC) != 0)
+            return false;
+        if (pipe2(out, O_CLOEXEC) != 0) {
+            close(in[0]);
+            close(in[1]);
+            return false;
+        }
+
+        pid = fork();
+        if (pid == 0) {
+            dup2(in[0], STDIN_FILENO);
+            dup2(out[1], STDOUT_FILENO);
+            close(in[0]); close(in[1]);
+            close(out[0]); close(out[1]);
+            execl(path.c_str(), path.c_str(), (char*)nullptr);
+            _exit(127);
+        }
+
+        close(in[0]);
+        close(out[1]);
+        to_engine = in[1];
+        from_engine = out[0];
+        buffer.clear();
+        return pid > 0;
+    }
+
+    void send(const string& cmd) {
+        string line = cmd + "\n";
+        if (write(to_engine, line.data(), line.size()) < 0)
+            return;
+    }
+
+    // next line within timeout ms, false on timeout or if the engine died
+    bool read_line(string& line, int64_t timeout) {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout);
+        while (true) {
+            size_t end = buffer.find('\n');
+            if (end != string::npos) {
+                line = buffer.substr(0, end);
+                buffer.erase(0, end + 1);
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                return true;
+            }
+
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+            if (left <= 0)
+                return false;
+
+            pollfd pfd = {from_engine, POLLIN, 0};
+            if (poll(&pfd, 1, (int)min<int64_t>(left, 1000)) <= 0)
+                continue;
+
+            char chunk[4096];
+            ssize_t n = read(from_engine, chunk, sizeof(chunk));
+            if (n <= 0)
+                return false;
+            buffer.append(chunk, n);
+        }
+    }
+
+    // reads until a line starting with token
+    bool wait_for(const string& token, string& line, int64_t timeout) {
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeout);
+        while (true) {
+            auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+            if (!read_line(line, max<int64_t>(left, 1)))
+                return false;
+            if (line.compare(0, token.size(), token) == 0)
+                return true;
+        }
+    }
+
+    void stop() {
+        if (pid <= 0)
+            return;
+        send("quit");
+        close(to_engine);
+        close(from_engine);
+
+        // give it a moment to exit on its own
+        for (int i = 0; i < 50 && waitpid(pid, nullptr, WNOHANG) == 0; i++)
+            this_thread::sleep_for(chrono::milliseconds(10));
+        if (waitpid(pid, nullptr, WNOHANG) == 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+        pid = -1;
+    }
+};
+
+bool init_engine(engine_process& engine, const engine_config& config) {
+    string line;
+    if (!engine.start(config.path))
+        return false;
+
+    engine.send("uci");
+    if (!engine.wait_for("uciok", line, READY_TIMEOUT))
+        return false;
+    for (auto& [name, value] : config.options)
+        engine.send("setoption name " + name + " value " + value);
+    engine.send("isready");
+    return engine.wait_for("readyok", line, READY_TIMEOUT);
+}
+
+///////////////////////////////////////////////////////////
+//                         Games                         //
+///////////////////////////////////////////////////////////
+
+enum {
+    WIN,        // for engine 1
+    LOSS,
+    DRAW
+};
+
+// white relative: 1 white wins, -1 black wins, 0 draw
+struct game_result {
+    int score;
+    string reason;
+};
+
+// the opening fen with whatever is left of the line, or startpos
+string position_command(const string& fen, const vector<string>& moves) {
+    string cmd = fen.empty() ? "position startpos" : "position fen " + fen;
+    if (!moves.empty()) {
+        cmd += " moves";
+        for (auto& m : moves)
+            cmd += " " + m;
+    }
+    return cmd;
+}
+
+// the moves played are left in played
+game_result play_game(engine_process* players[2], const string& fen, const match_config& config, vector<Move>& played) {
+    Boardstate B;
+    if (fen.empty())
+        B.reset();
+    else
+        B.set_fen(fen);
+
+    vector<uint64_t> hashes = {B.hash};
+    vector<string> moves;
+    played.clear();
+    int64_t clock[2] = {config.base_time, config.base_time};
+
+    for (int i = 0; i < 2; i++) {
+        engine_process* p = players[i];
+        string line;
+        p->send("ucinewgame");
+        p->send("isready");
+        p->wait_for("readyok", line, READY_TIMEOUT);
+    }
+
+    while (true) {
+        color us = B.to_move;
+        int loss = us == WHITE ? -1 : 1;
+
+        move_list legal;
+        generate_legal_moves(B, legal);
+        vector<Move> candidates(legal.captures.begin(), legal.captures.end());
+        candidates.insert(candidates.end(), legal.quiet.begin(), legal.quiet.end());
+
+        if (candidates.empty()) {
+            if (is_attacked(B, lsb(B.pieces[us][KING])))
+                return {loss, "checkmate"};
+            return {0, "stalemate"};
+        }
+
+        engine_process* engine = players[us];
+        engine->send(position_command(fen, moves));
+
+        string go = "go";
+        int64_t timeout = 60000;
+        if (config.base_time) {
+            go += " wtime " + to_string(clock[WHITE]) + " btime " + to_string(clock[BLACK])
+                + " winc " + to_string(config.increment) + " binc " + to_string(config.increment);
+            timeout = clock[us] + MOVE_MARGIN;
+        }
+        if (config.movetime) {
+            go += " movetime " + to_string(config.movetime);
+            timeout = config.movetime + MOVE_MARGIN;
+        }
+        if (config.nodes)
+            go += " nodes " + to_string(config.nodes);
+        if (config.depth)
+            go += " depth " + to_string(config.depth);
+
+        auto start = chrono::steady_clock::now();
+        engine->send(go);
+
+        string line;
+        if (!engine->wait_for("bestmove", line, timeout))
+            return {loss, "timeout or crash"};
+        int64_t used = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+        if (config.base_time) {
+            clock[us] -= used;
+            if (clock[us] < 0)
+                return {loss, "time forfeit"};
+            clock[us] += config.increment;
+        }
+
+        string token, move_str;
+        istringstream(line) >> token >> move_str;
+        auto it = find_if(candidates.begin(), candidates.end(),
+                          [&move_str](Move m) { return move_to_str(m) == move_str; });
+        if (it == candidates.end())
+            return {loss, "illegal move " + move_str};
+
+        B.make_move(*it);
+        moves.push_back(move_str);
+        played.push_back(*it);
+        hashes.push_back(B.hash);
+
+        int result = B.get_result();
+        if (result != 0)
+            return {result == 1 ? 1 : -1, "three checks"};
+        if (B.halfmove_clock >= 100)
+            return {0, "50 move rule"};
+        if (count(hashes.begin(), hashes.end(), B.hash) >= 3)
+            return {0, "repetition"};
+        if ((int)moves.size() >= MAX_PLIES)
+            return {0, "adjudicated"};
+    }
+}
+
+///////////////////////////////////////////////////////////
+//                   Statistics and SPRT                 //
+///////////////////////////////////////////////////////////
+
+double expected_score(double elo) {
+    return 1 / (1 + pow(10, -elo / 400));
+}
+
+// generalized sprt with the trinomial variance of the observed results
+// (https://www.chessprogramming.org/Match_Statistics); half a win and
+// half a loss are added so one-sided results (all wins, all draws)
+// still have a variance and move the llr
+double llr(int wins, int losses, int draws, double elo0, double elo1) {
+    if (wins + losses + draws == 0)
+        return 0;
+
+    double w = wins + 0.5, l = losses + 0.5;
+    double n = w + l + draws;
+    double score = (w + draws / 2.0) / n;
+    double variance = (w * pow(1 - score, 2) + draws * pow(0.5 - score, 2) + l * pow(score, 2)) / n;
+    double s0 = expected_score(elo0), s1 = expected_score(elo1);
+    return n * (s1 - s0) * (2 * score - s0 - s1) / (2 * variance);
+}
+
+// elo difference and its 95% interval from the score
+void elo_estimate(int wins, int losses, int draws, double& elo, double& margin) {
+    int n = wins + losses + draws;
+    double score = (wins + draws / 2.0) / n;
+    double variance = (wins * pow(1 - score, 2) + draws * pow(0.5 - score, 2) + losses * pow(score, 2)) / n;
+    auto to_elo = [](double s) {
+        s = clamp(s, 1e-6, 1 - 1e-6);
+        return -400 * log10(1 / s - 1);
+    };
+
+    double deviation = sqrt(variance / n);
+    elo = to_elo(score);
+    margin = (to_elo(score + 1.96 * deviation) - to_elo(score - 1.96 * deviation)) / 2;
+}
+
+///////////////////////////////////////////////////////////
+//                         Match                         //
+///////////////////////////////////////////////////////////
+
+struct match_state {
+    mutex lock;
+    atomic<int> next_game{0};
+    atomic<bool> finished{false};
+    int results[3] = {0, 0, 0};     // WIN, LOSS, DRAW of engine 1
+    int played = 0;
+    ofstream pgn;
+};
+
+void report(match_state& state, const match_config& config) {
+    if (state.played == 0) {
+        cout << "No games played\n";
+        return;
+    }
+
+    int w = state.results[WIN], l = state.results[LOSS], d = state.results[DRAW];
+    double elo, margin;
+    elo_estimate(w, l, d, elo, margin);
+
+    char line[256];
+    snprintf(line, sizeof(line), "Games %d: +%d -%d =%d  Elo %.1f +/- %.1f", state.played, w, l, d, elo, margin);
+    cout << line;
+
+    if (config.sprt) {
+        double lower = log(config.beta / (1 - config.alpha));
+        double upper = log((1 - config.beta) / config.alpha);
+        snprintf(line, sizeof(line), "  LLR %.2f [%.2f, %.2f]", llr(w, l, d, config.elo0, config.elo1), lower, upper);
+        cout << line;
+    }
+    cout << "\n" << flush;
+}
+
+void worker(match_state& state, const match_config& config) {
+    engine_process engines[2];
+    bool ready = false;
+
+    while (!state.finished) {
+        int game = state.next_game++;
+        if (game >= config.games)
+            break;
+
+        // fresh processes for the first game and after a crash
+        if (!ready) {
+            for (int i = 0; i < 2; i++) {
+                engines[i].stop();
+                if (!init_engine(engines[i], config.engines[i])) {
+                    lock_guard<mutex> guard(state.lock);
+                    cout << "Could not start " << config.engines[i].path << "\n";
+                    state.finished = true;
+                    break;
+                }
+            }
+            if (state.finished)
+                break;
+            ready = true;
+        }
+
+        // each opening twice, engine 1 plays white in the even games
+        string fen = config.openings.empty() ? "" : config.openings[(game / 2) % config.openings.size()];
+        bool first_white = game % 2 == 0;
+        engine_process* players[2] = {&engines[first_white ? 0 : 1], &engines[first_white ? 1 : 0]};
+
+        vector<Move> line;
+        game_result r = play_game(players, fen, config, line);
+        int outcome = r.score == 0 ? DRAW : ((r.score == 1) == first_white ? WIN : LOSS);
+        if (r.reason == "timeout or crash" || r.reason.compare(0, 7, "illegal") == 0)
+            ready = false;
+
+        // games still running when the match was decided are dropped,
+        // so the tallies, pgn and verdict stop at the deciding game
+        lock_guard<mutex> guard(state.lock);
+        if (state.finished)
+            break;
+        state.results[outcome]++;
+        state.played++;
+        cout << "Game " << game + 1 << " (" << (first_white ? "engine1" : "engine2") << " white): "
+             << (r.score == 1 ? "1-0" : r.score == -1 ? "0-1" : "1/2-1/2") << " {" << r.reason << "}\n";
+        report(state, config);
+
+        if (state.pgn.is_open()) {
+            char date[16];
+            time_t now = time(nullptr);
+            struct tm local;
+            strftime(date, sizeof(date), "%Y.%m.%d", localtime_r(&now, &local));
+
+            const string& white = config.engines[first_white ? 0 : 1].path;
+            const string& black = config.engines[first_white ? 1 : 0].path;
+            write_pgn(state.pgn, {{"Event", "selfplay"}, {"Site", "?"}, {"Date", date}, {"Round", to_string(game + 1)},
+                                  {"White", white}, {"Black", black}, {"Termination", r.reason}},
+                      fen, line, r.score);
+            state.pgn.flush();
+        }
+
+        if (config.sprt) {
+            double value = llr(state.results[WIN], state.results[LOSS], state.results[DRAW], config.elo0, config.elo1);
+            if (value <= log(config.beta / (1 - config.alpha))) {
+                cout << "SPRT: H0 accepted (elo <= " << config.elo0 << ")\n";
+                state.finished = true;
+            } else if (value >= log((1 - config.beta) / config.alpha)) {
+                cout << "SPRT: H1 accepted (elo >= " << config.elo1 << ")\n";
+                state.finished = true;
+            }
+        }
+    }
+
+    for (auto& e : engines)
+        e.stop();
+}
+
+// the board part of an epd line (4 fields, optional 3-check counters),
+// followed by a zero halfmove clock and move number for the engines
+vector<string> read_openings(const string& file) {
+    vector<string> openings;
+    ifstream in(file);
+    string line;
+    while (getline(in, line)) {
+        istringstream fields(line);
+        vector<string> tokens;
+        string token;
+        while (tokens.size() < 5 && fields >> token)
+            tokens.push_back(token);
+        if (tokens.size() < 4)
+            continue;
+
+        string fen = tokens[0] + " " + tokens[1] + " " + tokens[2] + " " + tokens[3];
+        if (tokens.size() == 5 && tokens[4].find('+') != string::npos)
+            fen += " " + tokens[4];
+        fen += " 0 1";
+
+        Boardstate B;
+        if (B.set_fen(fen))
+            openings.push_back(fen);
+        else
+            cout << "Skipping invalid opening " << line << "\n";
+    }
+    return openings;
+}
+
+void usage(const char* name) {
+    cout << "Usage: " << name << " [OPTIONS]\n"
+         << "  --engine1 PATH, --engine2 PATH   engines to match (default ./engine)\n"
+         << "  --option1 NAME=VALUE             uci option for engine 1 (repeatable)\n"
+         << "  --option2 NAME=VALUE             uci option for engine 2 (repeatable)\n"
+         << "  --openings FILE.epd              played twice each with colors swapped\n"
+         << "  --games N                        maximum number of games (default 1000)\n"
+         << "  --concurrency N                  games played at the same time (default 1)\n"
+         << "  --tc SECONDS[+INC]               clock per game, or per move limits:\n"
+         << "  --movetime MS, --nodes N, --depth N\n"
+         << "  --sprt ELO0 ELO1 [ALPHA BETA]    stop on a result (default alpha = beta = 0.05)\n"
+         << "  --pgn FILE                       append the games to FILE\n";
+}
+
+int main(int argc, char* argv[]) {
+    match_config config;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        auto next = [&](const char* fallback) { return i + 1 < argc ? string(argv[++i]) : string(fallback); };
+
+        if (arg == "--engine1" || arg == "--engine2") {
+            config.engines[arg.back() - '1'].path = next("./engine");
+        } else if (arg == "--option1" || arg == "--option2") {
+            string option = next("");
+            size_t eq = option.find('=');
+            if (eq != string::npos)
+                config.engines[arg.back() - '1'].options.push_back({option.substr(0, eq), option.substr(eq + 1)});
+        } else if (arg == "--openings") {
+            config.openings = read_openings(next(""));
+        } else if (arg == "--games") {
+            config.games = max(atoi(next("0").c_str()), 1);
+        } else if (arg == "--concurrency") {
+            config.concurrency = max(atoi(next("1").c_str()), 1);
+        } else if (arg == "--tc") {
+            string tc = next("10");
+            size_t plus = tc.find('+');
+            config.base_time = (int64_t)(atof(tc.substr(0, plus).c_str()) * 1000);
+            if (plus != string::npos)
+                config.increment = (int64_t)(atof(tc.substr(plus + 1).c_str()) * 1000);
+        } else if (arg == "--movetime") {
+            config.movetime = atoll(next("100").c_str());
+        } else if (arg == "--nodes") {
+            config.nodes = strtoull(next("10000").c_str(), nullptr, 10);
+        } else if (arg == "--depth") {
+            config.depth = atoi(next("6").c_str());
+        } else if (arg == "--pgn") {
+            config.pgn_file = next("");
+        } else if (arg == "--sprt") {
+            config.sprt = true;
+            config.elo0 = atof(next("0").c_str());
+            config.elo1 = atof(next("5").c_str());
+            if (i + 2 < argc && argv[i + 1][0] != '-') {
+                config.alpha = atof(argv[++i]);
+                config.beta = atof(argv[++i]);
+            }
+        } else {
+            usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    if (!config.base_time && !config.movetime && !config.nodes && !config.depth)
+        config.base_time = 10000, config.increment = 100;
+
+    // engines that die must not take the runner with them
+    signal(SIGPIPE, SIG_IGN);
+
+    init_move_tables();
+    init_eval_tables();
+    init_zobrist_table(0x0);
+
+    cout << config.engines[0].path << " vs " << config.engines[1].path << ", "
+         << (config.openings.empty() ? 1 : config.openings.size()) << " openings, "
+         << config.concurrency << " concurrent games\n" << flush;
+
+    match_state state;
+    if (!config.pgn_file.empty()) {
+        state.pgn.open(config.pgn_file, ios::app);
+        if (!state.pgn) {
+            cout << "Could not open " << config.pgn_file << "\n";
+            return 1;
+        }
+    }
+
+    vector<thread> workers;
+    for (int i = 0; i < config.concurrency; i++)
+        workers.emplace_back(worker, ref(state), cref(config));
+    for (auto& t : workers)
+        t.join();
+
+    cout << "\nFinal: ";
+    report(state, config);
+    return 0;
+}
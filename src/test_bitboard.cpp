@@ -23,8 +23,7 @@ void printBitboard(bitboard b)
 
 std::string move_to_string(Move m) {
     return std::to_string(get_src(m)) + " " + std::to_string(get_dest(m)) + " "
-         + std::to_string(get_piece(m)) + " " +std::to_string(get_promoted(m)) + " " 
-         + std::to_string(get_flags(m)) + " " +std::to_string(get_score(m));
+         + std::to_string(get_special(m)) + " " + std::to_string(get_promoted(m));
 }
 
 int main()
@@ -32,7 +31,8 @@ int main()
   init_move_tables();
   init_eval_tables();
   init_zobrist_table(0xdeadbeef);
-  set_search_depth(1);
+  SearchContext engine;
+  engine.set_depth(1);
 
   Boardstate B;
   B.reset();
@@ -81,13 +81,13 @@ int main()
   printBitboard(test_attack_tables(QUEEN, 0, t, block));
   
   std::cout << "\n < Boardstate and move gen >\n";
-  B.make_move(encode(d2, d4, PAWN, PAWN, NO_FLAGS));
-  B.make_move(encode(e7, e5, PAWN, PAWN, NO_FLAGS));
-  B.make_move(encode(b2, b7, PAWN, PAWN, CAPTURE));
-  B.make_move(encode(c7, c5, PAWN, PAWN, NO_FLAGS));
-  B.make_move(encode(g1, f3, KNIGHT, KNIGHT, NO_FLAGS));
-  B.make_move(encode(h7, h4, PAWN, PAWN, NO_FLAGS));
-  B.make_move(encode(g2, g4, PAWN, PAWN, ENPASSANT));
+  B.make_move(encode(d2, d4));
+  B.make_move(encode(e7, e5));
+  B.make_move(encode(b2, b7));
+  B.make_move(encode(c7, c5));
+  B.make_move(encode(g1, f3));
+  B.make_move(encode(h7, h4));
+  B.make_move(encode(g2, g4));
 
   std::cout << B.get_state();
   std::cout << "\n<   Move Generation   >\n";
@@ -99,19 +99,19 @@ int main()
   for (auto m : moves.quiet)
     std::cout << move_to_string(m) << "\n";
 
-  B.make_move(encode(h8, h6, ROOK, ROOK, NO_FLAGS));
-  B.make_move(encode(f1, g2, BISHOP, BISHOP, NO_FLAGS));
-  B.make_move(encode(d8, a5, QUEEN, QUEEN, NO_FLAGS));
+  B.make_move(encode(h8, h6));
+  B.make_move(encode(f1, g2));
+  B.make_move(encode(d8, a5));
 
   std::cout << '\n' << B.get_state() << '\n';
-  move_array<64> moves2;
+  move_array<MAX_MOVES> moves2;
   generate_capture_moves(B, moves2);
 
   for (auto m : moves2)
     std::cout << move_to_string(m) << "\n";
 
   std::cout << "\n<   Move execution   >\n";
-  Move m = search(B);
+  Move m = engine.search(B);
     std::cout << "Best move: " << move_to_string(m) << "\n";
   B.make_move(m);
   std::cout << B.get_state();
@@ -145,10 +145,10 @@ int main()
   std::cout << ".....\n\n";
 
   std::cout << B.get_state() << '\n';
-  set_search_depth(1);
-  m = search(B);
+  engine.set_depth(1);
+  m = engine.search(B);
   B.make_move(m);
-  m = search(B);
+  m = engine.search(B);
 
   move_list moves3;
   generate_all_moves(B, moves3);
@@ -160,9 +160,9 @@ int main()
 
     std::cout << move_to_string(m) << "\n";
     std::cout << B2.get_state();
-    auto& entry = get_entry(B2.hash);
-    std::cout << B2.hash << '\n';
-    std::cout << entry.zobrist << " " << entry.flag << " " << entry.depth << " " << move_to_string(entry.best_move)<< "\n";
+    auto& entry = engine.tt.get_entry(B2.hash);
+    std::cout << B2.hash << " " << hash_state(B2) << '\n';
+    std::cout << entry.zobrist << " " << (int)entry.flag << " " << (int)entry.depth << " " << move_to_string(entry.best_move)<< "\n";
     std::cout << evaluate(B2) << "\n\n";
   }
 
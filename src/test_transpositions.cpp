@@ -0,0 +1,75 @@
+#include "boardstate.h"
+#include "evaluate.h"
+#include "move_gen.h"
+#include "transpositions.h"
+#include "zobrist.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+int failures = 0;
+
+void check(bool ok, const std::string& what)
+{
+  std::cout << (ok ? "OK   " : "FAIL ") << what << '\n';
+  failures += !ok;
+}
+
+std::vector<char> read_file(const std::string& path)
+{
+  std::vector<char> bytes;
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file)
+    return bytes;
+  char buf[4096];
+  for (size_t n; (n = std::fread(buf, 1, sizeof(buf), file)) > 0;)
+    bytes.insert(bytes.end(), buf, buf + n);
+  std::fclose(file);
+  return bytes;
+}
+
+void write_file(const std::string& path, const std::vector<char>& bytes)
+{
+  FILE* file = std::fopen(path.c_str(), "wb");
+  std::fwrite(bytes.data(), 1, bytes.size(), file);
+  std::fclose(file);
+}
+
+int main()
+{
+  init_move_tables();
+  init_eval_tables();
+  init_zobrist_table(0xdeadbeef);
+
+  const std::string path = "test_transpositions.tt";
+  TransTable tt(1);
+  tt.store_entry(0x1234, 0, 5, EXACT, 42);
+  check(tt.save(path), "save");
+
+  TransTable same(1), other(2);
+  check(same.load(path) && same.get_entry(0x1234).score == 42, "load same size");
+  check(other.load(path) && other.get_entry(0x1234).score == 42, "load other size");
+  check(!same.load("missing.tt"), "missing file rejected");
+
+  std::vector<char> snapshot = read_file(path);
+
+  // truncated in the middle of an entry, and by a whole entry
+  std::vector<char> bytes(snapshot.begin(), snapshot.end() - 8);
+  write_file(path, bytes);
+  check(!other.load(path), "truncated file rejected");
+  bytes.resize(snapshot.size() - sizeof(hash_entry));
+  write_file(path, bytes);
+  check(!other.load(path), "missing entry rejected");
+
+  // only the header, with an entry count whose size wraps around to 0
+  bytes.assign(snapshot.begin(), snapshot.begin() + sizeof(tt_file_header));
+  tt_file_header* header = (tt_file_header*)bytes.data();
+  header->entries = 1ull << 60;
+  write_file(path, bytes);
+  check(!other.load(path), "inflated entry count rejected");
+  check(other.get_entry(0x1234).score == 42, "table unchanged after a bad file");
+
+  std::remove(path.c_str());
+  return failures != 0;
+}
@@ -1,36 +1,130 @@
 #include "transpositions.h"
-#include <array>
+#include "zobrist.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-static std::array<std::vector<hash_entry>, HASH_TABLE_SIZE> hash_table;
+static const char tt_magic[8] = {'F', 'L', 'T', 'T', 'S', 'N', 'A', 'P'};
 
-void clear_trans_table() {
-    for (auto& bucket : hash_table)
-        bucket.clear();
+TransTable::TransTable() : table(HASH_TABLE_SIZE), mask(HASH_TABLE_SIZE - 1) {}
+
+// largest power of two number of entries that fits in megabytes
+static size_t entries_for(size_t megabytes) {
+    size_t entries = 1;
+    while (entries * 2 * sizeof(hash_entry) <= megabytes << 20)
+        entries *= 2;
+    return entries;
 }
 
-int get_trans_table_size() {
+TransTable::TransTable(size_t megabytes)
+    : table(entries_for(megabytes), hash_entry{0, 0, 0, IGNORE, 0}), mask(table.size() - 1) {}
+
+void TransTable::clear() {
+    std::fill(table.begin(), table.end(), hash_entry{0, 0, 0, IGNORE, 0});
+}
+
+void TransTable::resize(size_t megabytes) {
+    size_t entries = entries_for(megabytes);
+    table.assign(entries, hash_entry{0, 0, 0, IGNORE, 0});
+    mask = entries - 1;
+}
+
+int TransTable::size() const {
     int acc = 0;
-    for (auto& bucket : hash_table)
-        acc += bucket.size();
-   
+    for (auto& entry : table)
+        acc += entry.flag != IGNORE;
+
     return acc;
 }
 
-void update_trans_table() {
-    if (get_trans_table_size() > HASH_TABLE_SIZE * 10)
-        clear_trans_table();
+int TransTable::hashfull() const {
+    size_t sample = std::min<size_t>(1000, table.size());
+    int used = 0;
+    for (size_t i = 0; i < sample; i++)
+        used += table[i].flag != IGNORE;
+
+    return used * 1000 / sample;
 }
 
-hash_entry& get_entry(uint64_t zobrist) {
-    int key = zobrist % HASH_TABLE_SIZE;
+void TransTable::store_entry(uint64_t zobrist, Move best_move, int depth, int flag, int score) {
+    auto& entry = get_entry(zobrist);
+    if (entry.zobrist != zobrist && entry.flag != IGNORE && entry.depth > depth)
+        return;
+
+    entry = {zobrist, best_move, (uint8_t)depth, (uint8_t)flag, score};
+}
+
+bool TransTable::save(const std::string& path) const {
+    tt_file_header header = {};
+    std::memcpy(header.magic, tt_magic, sizeof(tt_magic));
+    header.version = TT_FILE_VERSION;
+    header.entry_size = sizeof(hash_entry);
+    header.byte_order = 0x0102;
+    header.entries = table.size();
+    header.zobrist_seed = zobrist_seed;
+    header.zobrist_check = side_hash;
+
+    std::string tmp = path + ".tmp";
+    FILE* file = std::fopen(tmp.c_str(), "wb");
+    if (!file)
+        return false;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+           && std::fwrite(table.data(), sizeof(hash_entry), table.size(), file) == table.size();
+    ok &= std::fclose(file) == 0;
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool TransTable::load(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(tt_file_header))
+        mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+
+    // the entry count is checked against the file size by division, a
+    // product could overflow and let a bad header read past the mapping
+    const tt_file_header* header = (const tt_file_header*)mapped;
+    const hash_entry* entries = (const hash_entry*)(header + 1);
+    uint64_t payload = st.st_size - sizeof(tt_file_header);
+    uint64_t count = payload / sizeof(hash_entry);
+    bool ok = std::memcmp(header->magic, tt_magic, sizeof(tt_magic)) == 0
+           && header->version == TT_FILE_VERSION
+           && header->entry_size == sizeof(hash_entry)
+           && header->byte_order == 0x0102
+           && header->zobrist_seed == zobrist_seed
+           && header->zobrist_check == side_hash
+           && payload % sizeof(hash_entry) == 0
+           && header->entries == count;
 
-    auto& bucket = hash_table[key];
-    for (auto& a : bucket)
-        if (a.zobrist == zobrist)
-            return a;
+    if (ok && count == table.size()) {
+        std::memcpy(table.data(), entries, table.size() * sizeof(hash_entry));
+    } else if (ok) {
+        clear();
+        madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+        for (uint64_t i = 0; i < count; i++) {
+            const hash_entry& e = entries[i];
+            if (e.flag != IGNORE)
+                store_entry(e.zobrist, e.best_move, e.depth, e.flag, e.score);
+        }
+    }
 
-    bucket.push_back({zobrist, 0, 0, IGNORE});
-    return bucket.back();
+    munmap(mapped, st.st_size);
+    return ok;
 }
@@ -1,29 +1,90 @@
 #ifndef _TRANSPOSITIONS_H_
 #define _TRANSPOSITIONS_H_
-#include <bits/stdint-uintn.h>
+#include <stdint.h>
 #include <string>
+#include <vector>
+#include "move.h"
 
-#define HASH_TABLE_SIZE 32768
+// default number of entries (16 MB), always a power of two
+#define HASH_TABLE_SIZE (1 << 20)
 
+// 16 bytes, four entries per cache line
 struct hash_entry {
     uint64_t zobrist;
-    int depth;
-    int best_move;
-    int flag;
+    Move best_move;
+    uint8_t depth;
+    uint8_t flag;
+    int32_t score;      // white relative, mate scores relative to the node
 };
 
+// snapshot files: a tt_file_header followed by the raw entries, the
+// version is raised whenever hash_entry or the hashing changes
+#define TT_FILE_VERSION 1
+
+struct tt_file_header {
+    char magic[8];              // "FLTTSNAP"
+    uint32_t version;
+    uint16_t entry_size;        // sizeof(hash_entry)
+    uint16_t byte_order;        // 0x0102 as written by this machine
+    uint64_t entries;
+    uint64_t zobrist_seed;
+    uint64_t zobrist_check;     // side_hash, differs if the generator changed
+    uint64_t reserved[3];       // keeps the entries cache line aligned
+};
+
+// how score bounds the real (white relative) value
 enum {
     IGNORE = 0,
-    BEST_MOVE = 1,
-    GOOD_MOVE = 2,
+    EXACT = 1,
+    LOWER_BOUND = 2,
+    UPPER_BOUND = 3,
 };
 
-hash_entry& get_entry(uint64_t zobrist);
+// one table per SearchContext
+class TransTable
+{
+  public:
+    // HASH_TABLE_SIZE entries
+    TransTable();
+
+    // sized like resize(megabytes), without allocating twice
+    explicit TransTable(size_t megabytes);
+
+    // returns the slot for the position, check zobrist before using it
+    inline hash_entry& get_entry(uint64_t zobrist) {
+        return table[zobrist & mask];
+    }
+
+    // depth preferred replacement, entries of other positions are
+    // only overwritten by searches of at least the same depth
+    void store_entry(uint64_t zobrist, Move best_move, int depth, int flag, int score);
+
+    void clear();
 
-// clears tt if necessary
-void update_trans_table();
+    // number of used entries
+    int size() const;
+
+    // permille of used entries, sampled from the start of the table
+    int hashfull() const;
+
+    // resizes (and clears) the table to the largest power of two
+    // number of entries that fits in megabytes, at least one entry
+    void resize(size_t megabytes);
+
+    // writes the table to path, replaced only once the file is complete
+    bool save(const std::string& path) const;
+
+    // reads a snapshot written with the same zobrist tables, the table
+    // keeps its size: a snapshot of another size is merged by store_entry;
+    // false (table unchanged) if the file is missing or doesn't match
+    bool load(const std::string& path);
+
+  private:
+    std::vector<hash_entry> table;
+    uint64_t mask;
+};
 
-void clear_trans_table();
-int get_trans_table_size();
+static_assert(sizeof(hash_entry) == 16, "hash_entry should stay 16 bytes");
+static_assert(sizeof(tt_file_header) == 64, "snapshot header should stay 64 bytes");
 
 #endif 
@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "boardstate.h"
+#include "book.h"
+#include "evaluate.h"
+#include "logger.h"
+#include "move.h"
+#include "move_gen.h"
+#include "search.h"
+#include "transpositions.h"
+#include "uci.h"
+#include "zobrist.h"
+
+#define UNUSED(x) (void)(x) // mark args as redundant to silence compiler warnings
+#define output std::cout
+#define input std::cin
+#define DEFAULT_HASH 16
+#define MAX_HASH 4096
+#define MOVE_OVERHEAD 30    // ms kept back for communication
+#define MAX_MULTIPV 16
+
+static std::map<std::string, void (*)(std::istringstream& args)> uci_commands;
+static Boardstate position;
+static std::unique_ptr<SearchContext> engine;
+static bool running = true;
+static int multipv = 1;
+
+// OwnBook: moves of the BookFile are played without searching
+static Book book;
+static bool own_book = false;
+static std::mt19937_64 book_random{std::random_device{}()};
+
+// transposition table snapshot written and read by SaveHash / LoadHash
+static std::string hash_file;
+
+// debug on: search counters are sent as info string after every iteration
+static bool debug_mode = false;
+
+// the search runs on search_thread, the main thread keeps reading commands
+static std::thread search_thread;
+static std::mutex search_mutex;
+static std::condition_variable search_cv;
+
+// go infinite and go ponder only print bestmove after stop (or ponderhit)
+static bool wait_for_stop = false;
+
+// go ponder: limits applied on ponderhit, counted from that moment
+static bool pondering = false;
+static search_limits ponder_limits;
+
+///////////////////////////////////////////////////////////
+//                   Search reporting                    //
+///////////////////////////////////////////////////////////
+
+// centipawns or moves to mate, for the side to move
+std::string uci_score(int score, color to_move) {
+	if (to_move == BLACK)
+		score = -score;
+	if (score > MATE_BOUND)
+		return "mate " + std::to_string((MATE_SCORE - score + 1) / 2);
+	if (score < -MATE_BOUND)
+		return "mate -" + std::to_string((MATE_SCORE + score + 1) / 2);
+	return "cp " + std::to_string(score);
+}
+
+void print_info(const search_info& info, color to_move) {
+	uint64_t nps = info.time ? info.nodes * 1000 / info.time : 0;
+	std::string line = "info depth " + std::to_string(info.depth)
+		+ " multipv " + std::to_string(info.multipv)
+		+ " score " + uci_score(info.score, to_move)
+		+ " time " + std::to_string(info.time)
+		+ " nodes " + std::to_string(info.nodes)
+		+ " nps " + std::to_string(nps)
+		+ " hashfull " + std::to_string(info.hashfull)
+		+ " pv";
+	for (auto m : info.pv)
+		line += " " + move_to_str(m);
+	line += "\n";
+
+	if (debug_mode && info.multipv == 1)
+		line += "info string " + stats_to_str(info.stats) + "\n";
+	output << line << std::flush;
+}
+
+// stops the running search and waits for its bestmove
+void stop_search() {
+	if (!search_thread.joinable())
+		return;
+
+	engine->set_stop(true);
+	{
+		std::lock_guard<std::mutex> lock(search_mutex);
+		wait_for_stop = false;
+		pondering = false;
+	}
+	search_cv.notify_all();
+	search_thread.join();
+	engine->set_stop(false);
+
+	// a ponderhit after the search ended would leave its deadlines behind
+	engine->set_time(0, 0);
+}
+
+///////////////////////////////////////////////////////////
+//                    Time management                    //
+///////////////////////////////////////////////////////////
+
+// spends about 1/movestogo of the clock, more when the increment covers it,
+// never more than half of what is left
+void set_time_limits(search_limits& limits, int64_t time, int64_t inc, int movestogo) {
+	int moves = movestogo > 0 ? std::min(movestogo, 40) : 30;
+	int64_t left = std::max<int64_t>(time - MOVE_OVERHEAD, 1);
+	int64_t budget = std::min(left / moves + inc * 3 / 4, left / 2);
+
+	limits.soft_time = std::max<int64_t>(budget / 2, 1);
+	limits.hard_time = std::max<int64_t>(std::min(budget * 3, left / 2), 1);
+}
+
+///////////////////////////////////////////////////////////
+//                       Commands                        //
+///////////////////////////////////////////////////////////
+
+void uci(std::istringstream& args) {
+	UNUSED(args);
+	output << "id name FriedLiver\n"
+	       << "id author FriedLiver developers\n"
+	       << "option name Hash type spin default " << DEFAULT_HASH << " min 1 max " << MAX_HASH << "\n"
+	       << "option name Threads type spin default 1 min 1 max 1\n"
+	       << "option name Ponder type check default false\n"
+	       << "option name MultiPV type spin default 1 min 1 max " << MAX_MULTIPV << "\n"
+	       << "option name UCI_Variant type combo default 3check var 3check\n"
+	       << "option name OwnBook type check default false\n"
+	       << "option name BookFile type string default <empty>\n"
+	       << "option name HashFile type string default <empty>\n"
+	       << "option name SaveHash type button\n"
+	       << "option name LoadHash type button\n"
+	       << "uciok\n" << std::flush;
+}
+
+// debug [on | off]
+void debug(std::istringstream& args) {
+	std::string token;
+	args >> token;
+	debug_mode = token != "off";
+}
+
+void isready(std::istringstream& args) {
+	UNUSED(args);
+	output << "readyok\n" << std::flush;
+}
+
+void ucinewgame(std::istringstream& args) {
+	UNUSED(args);
+	stop_search();
+	engine->tt.clear();
+	engine->clear_game_history();
+	position.reset();
+}
+
+// setoption name <id> [value <x>], names can contain spaces
+void setoption(std::istringstream& args) {
+	std::string token, name, value;
+	args >> token;
+	while (args >> token && token != "value")
+		name += (name.empty() ? "" : " ") + token;
+	while (args >> token)
+		value += (value.empty() ? "" : " ") + token;
+
+	if (name == "Hash") {
+		int megabytes = 0;
+		std::istringstream(value) >> megabytes;
+		stop_search();
+		engine->tt.resize(std::clamp(megabytes, 1, MAX_HASH));
+	}
+	else if (name == "MultiPV") {
+		int lines = 1;
+		std::istringstream(value) >> lines;
+		multipv = std::clamp(lines, 1, MAX_MULTIPV);
+	}
+	else if (name == "OwnBook") {
+		own_book = value == "true";
+	}
+	else if (name == "BookFile") {
+		if (value.empty() || value == "<empty>")
+			book.close();
+		else if (!book.open(value))
+			output << "info string could not open book " << value << "\n" << std::flush;
+	}
+	else if (name == "HashFile") {
+		hash_file = value == "<empty>" ? "" : value;
+	}
+	// both stop a running search, load after ucinewgame (which clears the table)
+	else if (name == "SaveHash" || name == "LoadHash") {
+		stop_search();
+		bool saving = name == "SaveHash";
+		bool ok = !hash_file.empty() && (saving ? engine->tt.save(hash_file) : engine->tt.load(hash_file));
+		output << "info string " << (ok ? (saving ? "saved hash to " : "loaded hash from ")
+		                     : (saving ? "could not save hash to " : "could not load hash from "))
+		       << (hash_file.empty() ? "(no HashFile set)" : hash_file) << "\n" << std::flush;
+	}
+	else if (name == "UCI_Variant" && value != "3check") {
+		output << "info string only 3check is supported\n" << std::flush;
+	}
+	// Threads is fixed at 1, the search runs on a single thread
+	// Ponder only tells us the GUI may send go ponder
+}
+
+// position [startpos | fen <fen>] [moves <move1> ... <movei>]
+void position_cmd(std::istringstream& args) {
+	stop_search();
+
+	std::string token, fen;
+	args >> token;
+	if (token == "startpos") {
+		position.reset();
+		args >> token;
+	} else if (token == "fen") {
+		while (args >> token && token != "moves")
+			fen += (fen.empty() ? "" : " ") + token;
+		if (!position.set_fen(fen)) {
+			output << "info string invalid fen " << fen << "\n" << std::flush;
+			position.reset();
+		}
+	}
+
+	engine->clear_game_history();
+	if (token != "moves")
+		return;
+
+	while (args >> token) {
+		if (token.size() < 4 || token.size() > 5 ||
+		    token[0] < 'a' || token[0] > 'h' || token[1] < '1' || token[1] > '8' ||
+		    token[2] < 'a' || token[2] > 'h' || token[3] < '1' || token[3] > '8') {
+			output << "info string invalid move " << token << "\n" << std::flush;
+			return;
+		}
+		position.player_move(*engine, position.parse_move(token), true);
+	}
+}
+
+// go [wtime x] [btime x] [winc x] [binc x] [movestogo x] [movetime x]
+//    [depth x] [nodes x] [infinite] [ponder]
+void go(std::istringstream& args) {
+	stop_search();
+
+	search_limits limits;
+	int64_t time[2] = {0, 0}, inc[2] = {0, 0};
+	int64_t movetime = 0;
+	int movestogo = 0;
+	bool infinite = false, ponder = false;
+
+	std::string token;
+	while (args >> token) {
+		if (token == "wtime")			args >> time[WHITE];
+		else if (token == "btime")		args >> time[BLACK];
+		else if (token == "winc")		args >> inc[WHITE];
+		else if (token == "binc")		args >> inc[BLACK];
+		else if (token == "movestogo")	args >> movestogo;
+		else if (token == "movetime")	args >> movetime;
+		else if (token == "depth")		args >> limits.depth;
+		else if (token == "nodes")		args >> limits.nodes;
+		else if (token == "infinite")	infinite = true;
+		else if (token == "ponder")		ponder = true;
+	}
+	limits.depth = std::clamp(limits.depth, 1, MAX_PLY - 1);
+	limits.multipv = multipv;
+
+	// book moves are played at once, but never pondered or analyzed
+	if (own_book && !infinite && !ponder) {
+		Move m = book.pick(position, book_random());
+		if (m) {
+			output << "bestmove " << move_to_str(m) << "\n" << std::flush;
+			return;
+		}
+	}
+
+	color us = position.to_move;
+	if (movetime > 0)
+		limits.hard_time = std::max<int64_t>(movetime - MOVE_OVERHEAD, 1);
+	else if (time[us] > 0)
+		set_time_limits(limits, time[us], inc[us], movestogo);
+
+	// while pondering the clock is the opponent's, the limits start on ponderhit
+	ponder_limits = limits;
+	if (ponder) {
+		limits.soft_time = 0;
+		limits.hard_time = 0;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(search_mutex);
+		wait_for_stop = infinite || ponder;
+		pondering = ponder;
+	}
+
+	Boardstate root = position;
+	search_thread = std::thread([root, limits]() {
+		Move m = engine->think(root, limits, [&root](const search_info& info) {
+			print_info(info, root.to_move);
+		});
+
+		{
+			std::unique_lock<std::mutex> lock(search_mutex);
+			search_cv.wait(lock, []() { return !wait_for_stop; });
+		}
+
+		if (m == 0) {
+			output << "bestmove 0000\n" << std::flush;
+			return;
+		}
+
+		// the expected reply from the pv, for the GUI to ponder on
+		std::string bestmove = "bestmove " + move_to_str(m);
+		auto pv = engine->get_pv(root, 2);
+		if (pv.size() == 2 && pv[0] == m)
+			bestmove += " ponder " + move_to_str(pv[1]);
+		output << bestmove + "\n" << std::flush;
+	});
+}
+
+void stop(std::istringstream& args) {
+	UNUSED(args);
+	stop_search();
+}
+
+// the expected move was played, keep searching on our own clock
+void ponderhit(std::istringstream& args) {
+	UNUSED(args);
+	std::lock_guard<std::mutex> lock(search_mutex);
+	if (!pondering)
+		return;
+
+	pondering = false;
+	wait_for_stop = false;
+	engine->set_time(ponder_limits.soft_time, ponder_limits.hard_time);
+	search_cv.notify_all();
+}
+
+void quit(std::istringstream& args) {
+	UNUSED(args);
+	stop_search();
+	running = false;
+}
+
+void init_uci() {
+	uci_commands["uci"] = uci;
+	uci_commands["debug"] = debug;
+	uci_commands["isready"] = isready;
+	uci_commands["ucinewgame"] = ucinewgame;
+	uci_commands["setoption"] = setoption;
+	uci_commands["position"] = position_cmd;
+	uci_commands["go"] = go;
+	uci_commands["stop"] = stop;
+	uci_commands["ponderhit"] = ponderhit;
+	uci_commands["quit"] = quit;
+}
+
+void uci_loop() {
+	init_move_tables();
+	init_eval_tables();
+	init_zobrist_table(0x0);
+	engine = std::make_unique<SearchContext>();
+	init_uci();
+	position.reset();
+
+	std::istringstream no_args;
+	uci(no_args);
+
+	std::string line;
+	while (running && std::getline(input, line)) {
+		log("uci: " + line);
+
+		std::istringstream args(line);
+		std::string cmd;
+		args >> cmd;
+
+		auto to_execute = uci_commands.find(cmd);
+		if (to_execute != uci_commands.end())
+			to_execute->second(args);
+	}
+
+	stop_search();
+}
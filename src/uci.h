@@ -0,0 +1,7 @@
+#ifndef _UCI_H_
+#define _UCI_H_
+
+// runs the UCI protocol on stdin/stdout until quit,
+// the leading "uci" command has already been read
+void uci_loop();
+#endif
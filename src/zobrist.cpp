@@ -29,9 +29,12 @@ uint64_t hash_table[2][6][64];
 uint64_t check_hash_table[16];
 uint64_t castle_rights_hash_table[16];
 uint64_t enpass_square_hash_table[65];
+uint64_t side_hash;
+uint64_t zobrist_seed;
 
 void init_zobrist_table(uint64_t seed) {
-    
+    zobrist_seed = seed;
+
     ranctx x;
     x.a = 0xf1ea5eed;
     x.b = x.c = x.d = seed;
@@ -51,6 +54,8 @@ void init_zobrist_table(uint64_t seed) {
     
     for (int i = 0; i < 65; i++)
         enpass_square_hash_table[i] = RKISS(x);
+
+    side_hash = RKISS(x);
 }
 
 uint64_t hash_state(const Boardstate& B) {
@@ -64,6 +69,8 @@ uint64_t hash_state(const Boardstate& B) {
     
     h ^= check_hash_table[B.flags.to_byte() >> 4];
     h ^= castle_rights_hash_table[B.flags.to_byte() & 0xf];
-    h ^= enpass_square_hash_table[B.enpassant]; 
+    h ^= enpass_square_hash_table[B.enpassant];
+    if (B.to_move == BLACK)
+        h ^= side_hash;
     return h;
 }
@@ -9,6 +9,10 @@ extern uint64_t hash_table[2][6][64];
 extern uint64_t check_hash_table[16];
 extern uint64_t castle_rights_hash_table[16];
 extern uint64_t enpass_square_hash_table[65];
+extern uint64_t side_hash;
+
+// seed the tables were generated from
+extern uint64_t zobrist_seed;
 
 // init hash table
 void init_zobrist_table(uint64_t seed);